@@ -0,0 +1,324 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "RawTXTHTraceFileWriter.h"
+#include "TraceFileWriter.h"
+#include "osi_groundtruth.pb.h"
+#include "osi_sensordata.pb.h"
+#include "osi_sensorview.pb.h"
+
+/*
+ * Throughput benchmark of TraceFileWriter::Init/Step/Term for all message types and file formats.
+ *
+ * Each benchmark is run with the arguments {number of moving and stationary objects, number of
+ * points per lane boundary}, which together determine the size of the synthetic frames.
+ * Every iteration records a complete trace file of kFramesPerIteration frames, so the time of
+ * Term() (final flush, MCAP summary, draining the compression and writer threads) is part of the
+ * throughput. Only Init() is excluded.
+ * Reported counters: bytes_per_second (MB/s), items_per_second (frames/s), p50_us and p99_us
+ * (step latency in microseconds) and frame_bytes.
+ *
+ * FormatTextFrame/<type>/{reused,fresh} compare the .txth formatting of one frame with the message
+ * object reused per thread (FormatTextFrame()) against a new message object for every frame.
+ * ParseFrame/<type>/{reused,fresh} measure only the parse step of both, which the reuse speeds up.
+ */
+
+namespace
+{
+
+osi3::GroundTruth CreateGroundTruth(int num_objects, int num_boundary_points)
+{
+    osi3::GroundTruth ground_truth;
+    ground_truth.mutable_version()->set_version_major(3);
+    ground_truth.mutable_version()->set_version_minor(7);
+    ground_truth.mutable_version()->set_version_patch(0);
+    ground_truth.mutable_host_vehicle_id()->set_value(0);
+    for (int i = 0; i < num_objects; i++)
+    {
+        auto* moving_object = ground_truth.add_moving_object();
+        moving_object->mutable_id()->set_value(i);
+        moving_object->mutable_base()->mutable_dimension()->set_length(4.5);
+        moving_object->mutable_base()->mutable_dimension()->set_width(1.8);
+        moving_object->mutable_base()->mutable_dimension()->set_height(1.5);
+        moving_object->mutable_base()->mutable_position()->set_x(10.0 * i);
+        moving_object->mutable_base()->mutable_position()->set_y(3.5);
+        moving_object->mutable_base()->mutable_orientation()->set_yaw(0.01 * i);
+        moving_object->mutable_base()->mutable_velocity()->set_x(20.0);
+
+        auto* stationary_object = ground_truth.add_stationary_object();
+        stationary_object->mutable_id()->set_value(num_objects + i);
+        stationary_object->mutable_base()->mutable_dimension()->set_length(1.0);
+        stationary_object->mutable_base()->mutable_position()->set_x(10.0 * i);
+        stationary_object->mutable_base()->mutable_position()->set_y(-7.0);
+    }
+    for (int boundary = 0; boundary < 4; boundary++)
+    {
+        auto* lane_boundary = ground_truth.add_lane_boundary();
+        lane_boundary->mutable_id()->set_value(2 * num_objects + boundary);
+        for (int i = 0; i < num_boundary_points; i++)
+        {
+            auto* boundary_point = lane_boundary->add_boundary_line();
+            boundary_point->mutable_position()->set_x(0.5 * i);
+            boundary_point->mutable_position()->set_y(3.5 * boundary);
+            boundary_point->set_width(0.15);
+        }
+    }
+    return ground_truth;
+}
+
+template <typename T>
+T CreateMessage(int num_objects, int num_boundary_points);
+
+template <>
+osi3::GroundTruth CreateMessage<osi3::GroundTruth>(int num_objects, int num_boundary_points)
+{
+    return CreateGroundTruth(num_objects, num_boundary_points);
+}
+
+template <>
+osi3::SensorView CreateMessage<osi3::SensorView>(int num_objects, int num_boundary_points)
+{
+    osi3::SensorView sensor_view;
+    *sensor_view.mutable_global_ground_truth() = CreateGroundTruth(num_objects, num_boundary_points);
+    *sensor_view.mutable_version() = sensor_view.global_ground_truth().version();
+    sensor_view.mutable_sensor_id()->set_value(0);
+    return sensor_view;
+}
+
+template <>
+osi3::SensorData CreateMessage<osi3::SensorData>(int num_objects, int num_boundary_points)
+{
+    osi3::SensorData sensor_data;
+    *sensor_data.add_sensor_view() = CreateMessage<osi3::SensorView>(num_objects, num_boundary_points);
+    *sensor_data.mutable_version() = sensor_data.sensor_view(0).version();
+    sensor_data.mutable_sensor_id()->set_value(0);
+    return sensor_data;
+}
+
+// frames with increasing timestamps, as they would be received during a simulation
+template <typename T>
+std::vector<std::string> CreateFrames(int num_objects, int num_boundary_points, int num_frames)
+{
+    T message = CreateMessage<T>(num_objects, num_boundary_points);
+    std::vector<std::string> frames(num_frames);
+    for (int i = 0; i < num_frames; i++)
+    {
+        message.mutable_timestamp()->set_seconds(i / 50);
+        message.mutable_timestamp()->set_nanos((i % 50) * 20000000);
+        frames[i] = message.SerializeAsString();
+    }
+    return frames;
+}
+
+/** Uniform sample of a fixed number of step latencies (reservoir sampling), so memory does not grow with the iterations */
+class LatencySample
+{
+  public:
+    static constexpr size_t kMaxSize = 100000;
+
+    LatencySample() { values_.reserve(kMaxSize); }
+
+    void Add(double value)
+    {
+        num_values_++;
+        if (values_.size() < kMaxSize)
+        {
+            values_.push_back(value);
+            return;
+        }
+        const uint64_t index = std::uniform_int_distribution<uint64_t>(0, num_values_ - 1)(random_);
+        if (index < kMaxSize)
+        {
+            values_[index] = value;
+        }
+    }
+
+    std::vector<double>& Values() { return values_; }
+
+  private:
+    std::vector<double> values_;
+    uint64_t num_values_ = 0;
+    std::minstd_rand random_;
+};
+
+double Percentile(std::vector<double>& values, double percentile)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    const auto index = static_cast<size_t>(percentile * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+    return values[index];
+}
+
+template <typename T>
+void BmStep(benchmark::State& state, const std::string& message_type, FileFormat file_format, const TraceFileWriterOptions& options)
+{
+    constexpr int kNumDistinctFrames = 16;
+    constexpr int kFramesPerIteration = 64;
+    const auto frames = CreateFrames<T>(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), kNumDistinctFrames);
+
+    const auto trace_folder = std::filesystem::temp_directory_path() / "trace_writer_bench";
+    std::filesystem::remove_all(trace_folder);
+    std::filesystem::create_directories(trace_folder);
+
+    LatencySample step_latencies_us;
+    size_t num_frames = 0;
+    size_t num_bytes = 0;
+    for (auto _ : state)
+    {
+        // every trace file has the same name, as the timestamp is omitted, so the folder does not grow
+        state.PauseTiming();
+        TraceFileWriter trace_file_writer;
+        trace_file_writer.Init(trace_folder.string(), "2112", "bench", message_type, file_format, true, options);
+        state.ResumeTiming();
+
+        bool success = true;
+        for (int i = 0; i < kFramesPerIteration && success; i++)
+        {
+            const auto& frame = frames[i % kNumDistinctFrames];
+            const auto start = std::chrono::steady_clock::now();
+            success = trace_file_writer.Step(frame.data(), static_cast<int>(frame.size()), 0.02 * i);
+            const auto stop = std::chrono::steady_clock::now();
+            step_latencies_us.Add(std::chrono::duration<double, std::micro>(stop - start).count());
+            num_bytes += frame.size();
+        }
+        trace_file_writer.Term();
+        if (!success)
+        {
+            state.SkipWithError("TraceFileWriter::Step failed");
+            break;
+        }
+        num_frames += kFramesPerIteration;
+    }
+    std::filesystem::remove_all(trace_folder);
+
+    state.SetItemsProcessed(static_cast<int64_t>(num_frames));
+    state.SetBytesProcessed(static_cast<int64_t>(num_bytes));
+    state.counters["frame_bytes"] = static_cast<double>(frames.front().size());
+    state.counters["p50_us"] = Percentile(step_latencies_us.Values(), 0.50);
+    state.counters["p99_us"] = Percentile(step_latencies_us.Values(), 0.99);
+}
+
+/** FormatTextFrame() with a new message object for every frame, the baseline of the reused one */
+template <typename T>
+bool FormatTextFrameFresh(const void* data, int size, std::string& text)
+{
+    T message;
+    if (!message.ParseFromArray(data, size))
+    {
+        return false;
+    }
+    text.clear();
+    return google::protobuf::TextFormat::PrintToString(message, &text);
+}
+
+template <typename T>
+bool ParseFrameReused(const void* data, int size, std::string& /*text*/)
+{
+    thread_local T message;
+    return message.ParseFromArray(data, size);
+}
+
+template <typename T>
+bool ParseFrameFresh(const void* data, int size, std::string& /*text*/)
+{
+    T message;
+    return message.ParseFromArray(data, size);
+}
+
+/** Formats (or only parses) the frames with one of the functions above */
+template <typename T>
+void BmFormatTextFrame(benchmark::State& state, TextFrameFormatter format)
+{
+    constexpr int kNumDistinctFrames = 16;
+    const auto frames = CreateFrames<T>(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), kNumDistinctFrames);
+
+    std::string text;
+    size_t num_frames = 0;
+    size_t num_bytes = 0;
+    for (auto _ : state)
+    {
+        const auto& frame = frames[num_frames % kNumDistinctFrames];
+        if (!format(frame.data(), static_cast<int>(frame.size()), text))
+        {
+            state.SkipWithError("Could not format the frame");
+            break;
+        }
+        benchmark::DoNotOptimize(text.data());
+        num_frames++;
+        num_bytes += frame.size();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(num_frames));
+    state.SetBytesProcessed(static_cast<int64_t>(num_bytes));
+    state.counters["frame_bytes"] = static_cast<double>(frames.front().size());
+}
+
+template <typename T>
+void RegisterMessageType(const std::string& message_type)
+{
+    TraceFileWriterOptions parallel_txth;
+    parallel_txth.txth_format_threads = std::max(std::thread::hardware_concurrency(), 2U);
+    const std::vector<std::tuple<std::string, FileFormat, TraceFileWriterOptions>> file_formats = {
+        {"mcap", FileFormat::MCAP, {}}, {"osi", FileFormat::OSI, {}}, {"txth", FileFormat::TXTH, {}}, {"txth_parallel", FileFormat::TXTH, parallel_txth}};
+    for (const auto& [format_name, file_format, options] : file_formats)
+    {
+        benchmark::RegisterBenchmark(("Step/" + message_type + "/" + format_name).c_str(), BmStep<T>, message_type, file_format, options)
+            ->ArgNames({"objects", "boundary_points"})
+            ->Args({10, 100})
+            ->Args({100, 1000})
+            ->Args({1000, 10000})
+            ->UseRealTime()  // the writer and compression threads do not count to the CPU time of the benchmark thread
+            ->Unit(benchmark::kMicrosecond);
+    }
+
+    const std::vector<std::pair<std::string, TextFrameFormatter>> formatters = {{"FormatTextFrame/" + message_type + "/reused", &FormatTextFrame<T>},
+                                                                                {"FormatTextFrame/" + message_type + "/fresh", &FormatTextFrameFresh<T>},
+                                                                                {"ParseFrame/" + message_type + "/reused", &ParseFrameReused<T>},
+                                                                                {"ParseFrame/" + message_type + "/fresh", &ParseFrameFresh<T>}};
+    for (const auto& [benchmark_name, format] : formatters)
+    {
+        benchmark::RegisterBenchmark(benchmark_name.c_str(), BmFormatTextFrame<T>, format)
+            ->ArgNames({"objects", "boundary_points"})
+            ->Args({10, 100})
+            ->Args({100, 1000})
+            ->Args({1000, 10000})
+            ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    RegisterMessageType<osi3::GroundTruth>("gt");
+    RegisterMessageType<osi3::SensorView>("sv");
+    RegisterMessageType<osi3::SensorData>("sd");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
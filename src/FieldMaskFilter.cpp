@@ -0,0 +1,123 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "FieldMaskFilter.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace
+{
+constexpr int kMaxVarint32Bytes = 5;
+}  // namespace
+
+FieldMaskFilter::FieldMaskFilter(const google::protobuf::Descriptor* descriptor, const std::string& paths)
+{
+    std::stringstream path_stream(paths);
+    std::string path;
+    while (std::getline(path_stream, path, ','))
+    {
+        path.erase(0, path.find_first_not_of(" \t"));
+        path.erase(path.find_last_not_of(" \t") + 1);
+        if (!path.empty())
+        {
+            AddPath(descriptor, path);
+        }
+    }
+    // sized up front, so references into it stay valid while nested sub-messages are filtered
+    scratch_.resize(max_depth_);
+    for (const char* name : {"version", "timestamp"})
+    {
+        if (const auto* field = descriptor->FindFieldByName(name))
+        {
+            root_.children[field->number()].keep_all = true;
+        }
+    }
+}
+
+void FieldMaskFilter::AddPath(const google::protobuf::Descriptor* descriptor, const std::string& path)
+{
+    Node* node = &root_;
+    size_t depth = 0;
+    std::stringstream part_stream(path);
+    std::string part;
+    while (std::getline(part_stream, part, '.'))
+    {
+        if (descriptor == nullptr)
+        {
+            throw std::invalid_argument("Field mask path " + path + " continues below a scalar field");
+        }
+        const auto* field = descriptor->FindFieldByName(part);
+        if (field == nullptr)
+        {
+            throw std::invalid_argument("Unknown field " + part + " in field mask path " + path + " of " + descriptor->full_name());
+        }
+        node = &node->children[field->number()];
+        descriptor = field->message_type();
+        depth++;
+    }
+    node->keep_all = true;
+    max_depth_ = std::max(max_depth_, depth);
+}
+
+bool FieldMaskFilter::Apply(const void* data, int size, std::string& output)
+{
+    output.clear();
+    return Filter(static_cast<const uint8_t*>(data), size, root_, 0, output);
+}
+
+bool FieldMaskFilter::Filter(const uint8_t* data, int size, const Node& node, size_t depth, std::string& output)
+{
+    google::protobuf::io::CodedInputStream input(data, size);
+    while (true)
+    {
+        const int field_start = input.CurrentPosition();
+        const uint32_t tag = input.ReadTag();
+        if (tag == 0)
+        {
+            break;
+        }
+        const auto child = node.children.find(WireFormatLite::GetTagFieldNumber(tag));
+        const bool nested = child != node.children.end() && !child->second.keep_all && WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+        if (!nested)
+        {
+            if (!WireFormatLite::SkipField(&input, tag))
+            {
+                return false;
+            }
+            if (child != node.children.end())
+            {
+                output.append(reinterpret_cast<const char*>(data) + field_start, static_cast<size_t>(input.CurrentPosition() - field_start));
+            }
+            continue;
+        }
+
+        // sub-message with a nested path: filter it and write it with its new length
+        const int tag_end = input.CurrentPosition();
+        uint32_t length = 0;
+        if (!input.ReadVarint32(&length) || static_cast<int64_t>(length) > size - input.CurrentPosition())
+        {
+            return false;
+        }
+        std::string& sub_message = scratch_[depth];
+        sub_message.clear();
+        if (!Filter(data + input.CurrentPosition(), static_cast<int>(length), child->second, depth + 1, sub_message) || !input.Skip(static_cast<int>(length)))
+        {
+            return false;
+        }
+        uint8_t length_bytes[kMaxVarint32Bytes];
+        const uint8_t* length_end = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(sub_message.size()), length_bytes);
+        output.append(reinterpret_cast<const char*>(data) + field_start, static_cast<size_t>(tag_end - field_start));
+        output.append(reinterpret_cast<const char*>(length_bytes), static_cast<size_t>(length_end - length_bytes));
+        output.append(sub_message);
+    }
+    return input.ConsumedEntireMessage();
+}
@@ -0,0 +1,74 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+
+#include "TraceFileWriter.h"
+
+/**
+ * Reduces serialized messages to the fields of a protobuf FieldMask-style list of paths,
+ * e.g. "moving_object.base,lane.id". The filtering is done on the wire format: unwanted fields
+ * are skipped without being parsed, kept fields are copied as they are, and only sub-messages
+ * with a nested path are rewritten.
+ * The top-level version and timestamp are always kept, as they are needed for the trace file.
+ */
+class FieldMaskFilter
+{
+  public:
+    /**
+     * \param descriptor type of the filtered messages
+     * \param paths comma separated field paths, throws std::invalid_argument for unknown fields
+     */
+    FieldMaskFilter(const google::protobuf::Descriptor* descriptor, const std::string& paths);
+
+    /** Write the kept fields of the serialized message to output, false if the wire format is malformed */
+    bool Apply(const void* data, int size, std::string& output);
+
+  private:
+    struct Node
+    {
+        bool keep_all = false;
+        std::map<int, Node> children;  // by field number
+    };
+
+    void AddPath(const google::protobuf::Descriptor* descriptor, const std::string& path);
+    bool Filter(const uint8_t* data, int size, const Node& node, size_t depth, std::string& output);
+
+    Node root_;
+    size_t max_depth_ = 0;
+    std::vector<std::string> scratch_;  // filtered sub-messages by nesting depth, reused for every frame
+};
+
+/** Applies a FieldMaskFilter before the frames are written by the wrapped frame writer */
+class FieldMaskFrameWriter final : public IFrameWriter
+{
+  public:
+    FieldMaskFrameWriter(std::unique_ptr<IFrameWriter> frame_writer, const google::protobuf::Descriptor* descriptor, const std::string& paths)
+        : frame_writer_(std::move(frame_writer)), filter_(descriptor, paths)
+    {
+    }
+
+    bool Write(const void* data, int size, double sim_time) override
+    {
+        if (!filter_.Apply(data, size, filtered_))
+        {
+            return false;
+        }
+        return frame_writer_->Write(filtered_.data(), static_cast<int>(filtered_.size()), sim_time);
+    }
+
+  private:
+    std::unique_ptr<IFrameWriter> frame_writer_;
+    FieldMaskFilter filter_;
+    std::string filtered_;
+};
@@ -0,0 +1,101 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "FrameBufferPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::unique_ptr<FrameBuffer> FrameBufferPool::Acquire(const void* data, size_t size)
+{
+    size_t size_class = 0;
+    size_t capacity = kMinSizeClassBytes;
+    while (capacity < size)
+    {
+        capacity *= 2;
+        size_class++;
+    }
+
+    std::unique_ptr<FrameBuffer> buffer;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (max_buffers_ > 0)
+        {
+            buffer_released_.wait(lock, [this] { return num_in_use_ < max_buffers_; });
+        }
+        buffer = TakeFreeBuffer(size_class, false);
+        if (!buffer && max_buffers_ > 0 && num_in_use_ + num_free_ >= max_buffers_)
+        {
+            // no new buffer beyond the limit, a free buffer of a smaller size class is reallocated instead
+            buffer = TakeFreeBuffer(size_class, true);
+        }
+        num_in_use_++;
+        high_water_mark_ = std::max(high_water_mark_, num_in_use_);
+    }
+
+    if (!buffer)
+    {
+        buffer = std::make_unique<FrameBuffer>();
+    }
+    if (buffer->capacity < size)
+    {
+        buffer->data.reset(new char[capacity]);
+        buffer->capacity = capacity;
+        buffer->size_class = size_class;
+    }
+    std::memcpy(buffer->data.get(), data, size);
+    buffer->size = size;
+    buffer->sim_time = 0.0;
+    buffer->starts_segment = false;
+    buffer->channel = 0;
+    return buffer;
+}
+
+void FrameBufferPool::Release(std::unique_ptr<FrameBuffer> buffer)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_in_use_--;
+        if (buffer->size_class >= free_buffers_.size())
+        {
+            free_buffers_.resize(buffer->size_class + 1);
+        }
+        free_buffers_[buffer->size_class].push_back(std::move(buffer));
+        num_free_++;
+    }
+    buffer_released_.notify_one();
+}
+
+std::unique_ptr<FrameBuffer> FrameBufferPool::TakeFreeBuffer(size_t size_class, bool any_size)
+{
+    // the smallest free buffer the frame fits into, or with any_size the largest one it does not fit into
+    auto take = [this](size_t index) {
+        auto buffer = std::move(free_buffers_[index].back());
+        free_buffers_[index].pop_back();
+        num_free_--;
+        return buffer;
+    };
+    for (size_t index = size_class; index < free_buffers_.size(); index++)
+    {
+        if (!free_buffers_[index].empty())
+        {
+            return take(index);
+        }
+    }
+    for (size_t index = std::min(size_class, free_buffers_.size()); any_size && index > 0; index--)
+    {
+        if (!free_buffers_[index - 1].empty())
+        {
+            return take(index - 1);
+        }
+    }
+    return nullptr;
+}
+
+size_t FrameBufferPool::HighWaterMark() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return high_water_mark_;
+}
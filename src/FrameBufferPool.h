@@ -0,0 +1,70 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/** Copy of one serialized frame, owned by a FrameBufferPool */
+struct FrameBuffer
+{
+    std::unique_ptr<char[]> data;
+    size_t capacity = 0;
+    size_t size = 0;
+    size_t size_class = 0;
+    double sim_time = 0.0;         // simulation time of the frame in seconds
+    bool starts_segment = false;  // first frame of a triggered recording, written to a new trace file segment
+    size_t channel = 0;           // input stream of the frame
+};
+
+/**
+ * Pool of reusable frame buffers in power of two size classes. Buffers are handed out by
+ * Acquire() and given back with Release() after the frame was written, so in steady state
+ * copying a frame does not allocate.
+ *
+ * With a maximum number of buffers, the pool never owns more buffers than that, in use or free.
+ * A free buffer of another size class is reused or reallocated instead of adding a buffer, and
+ * Acquire() waits while all buffers are in use.
+ */
+class FrameBufferPool
+{
+  public:
+    /** \param max_buffers maximum number of buffers, 0 for no limit */
+    explicit FrameBufferPool(size_t max_buffers = 0) : max_buffers_(max_buffers) {}
+
+    /** Change the maximum number of buffers, only before the first Acquire() */
+    void SetMaxBuffers(size_t max_buffers) { max_buffers_ = max_buffers; }
+
+    /**
+     * Get a buffer and copy the frame into it, waits for a Release() if all buffers are in use.
+     *
+     * \param data serialized frame
+     * \param size size of the frame in bytes
+     */
+    std::unique_ptr<FrameBuffer> Acquire(const void* data, size_t size);
+
+    /** Give a buffer back to the pool for reuse */
+    void Release(std::unique_ptr<FrameBuffer> buffer);
+
+    /** Highest number of buffers in use at the same time */
+    size_t HighWaterMark() const;
+
+  private:
+    static constexpr size_t kMinSizeClassBytes = 64 * 1024;
+
+    std::unique_ptr<FrameBuffer> TakeFreeBuffer(size_t size_class, bool any_size);
+
+    size_t max_buffers_;
+    mutable std::mutex mutex_;
+    std::condition_variable buffer_released_;
+    std::vector<std::vector<std::unique_ptr<FrameBuffer>>> free_buffers_;  // indexed by size class
+    size_t num_free_ = 0;
+    size_t num_in_use_ = 0;
+    size_t high_water_mark_ = 0;
+};
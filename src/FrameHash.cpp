@@ -0,0 +1,110 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "FrameHash.h"
+
+#include <cstring>
+
+namespace
+{
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t RotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t Read64(const uint8_t* data)
+{
+    uint64_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t Read32(const uint8_t* data)
+{
+    uint32_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * kPrime2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= Round(0, accumulator);
+    return hash * kPrime1 + kPrime4;
+}
+}  // namespace
+
+uint64_t XxHash64(const void* data, size_t size, uint64_t seed)
+{
+    const auto* input = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = input + size;
+    uint64_t hash = 0;
+
+    if (size >= 32)
+    {
+        // four independent accumulators, so the multiplications of one stripe run in parallel
+        uint64_t accumulator1 = seed + kPrime1 + kPrime2;
+        uint64_t accumulator2 = seed + kPrime2;
+        uint64_t accumulator3 = seed;
+        uint64_t accumulator4 = seed - kPrime1;
+        const uint8_t* const last_stripe = end - 32;
+        do
+        {
+            accumulator1 = Round(accumulator1, Read64(input));
+            accumulator2 = Round(accumulator2, Read64(input + 8));
+            accumulator3 = Round(accumulator3, Read64(input + 16));
+            accumulator4 = Round(accumulator4, Read64(input + 24));
+            input += 32;
+        } while (input <= last_stripe);
+
+        hash = RotateLeft(accumulator1, 1) + RotateLeft(accumulator2, 7) + RotateLeft(accumulator3, 12) + RotateLeft(accumulator4, 18);
+        hash = MergeRound(hash, accumulator1);
+        hash = MergeRound(hash, accumulator2);
+        hash = MergeRound(hash, accumulator3);
+        hash = MergeRound(hash, accumulator4);
+    }
+    else
+    {
+        hash = seed + kPrime5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    for (; input + 8 <= end; input += 8)
+    {
+        hash ^= Round(0, Read64(input));
+        hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (input + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(Read32(input)) * kPrime1;
+        hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+        input += 4;
+    }
+    for (; input < end; input++)
+    {
+        hash ^= static_cast<uint64_t>(*input) * kPrime5;
+        hash = RotateLeft(hash, 11) * kPrime1;
+    }
+
+    // avalanche
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
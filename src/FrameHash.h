@@ -0,0 +1,15 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 64 bit xxHash (XXH64) of a byte range, a fast non-cryptographic hash that reads 32 bytes per round.
+ * Used to detect whether serialized content changed, the values are only compared within one process.
+ */
+uint64_t XxHash64(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,48 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * Record layout of the sidecar frame index of binary .osi trace files, shared by
+ * RawBinaryTraceFileWriter and the trace recovery tool.
+ *
+ * The index starts with the magic, followed by one fixed size record per frame: uint32 frame number,
+ * uint32 message size, uint64 byte offset of the length prefix in the uncompressed frame stream and
+ * uint64 OSI timestamp in nanoseconds, all little-endian.
+ */
+constexpr char kFrameIndexMagic[] = "OSIIDX01";
+constexpr size_t kFrameIndexMagicSize = sizeof(kFrameIndexMagic) - 1;
+constexpr size_t kFrameIndexRecordSize = 24;
+
+/** Path of the sidecar index of a trace file (trace file name + .idx) */
+inline std::filesystem::path FrameIndexPath(const std::filesystem::path& trace_path)
+{
+    auto index_path = trace_path;
+    index_path += ".idx";
+    return index_path;
+}
+
+template <typename T>
+inline void AppendLittleEndian(char*& out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        *out++ = static_cast<char>((value >> (8U * i)) & 0xFFU);
+    }
+}
+
+/** Encode one index record into kFrameIndexRecordSize bytes at record */
+inline void EncodeFrameIndexRecord(char* record, uint32_t frame_number, uint32_t message_size, uint64_t stream_offset, uint64_t timestamp_ns)
+{
+    AppendLittleEndian(record, frame_number);
+    AppendLittleEndian(record, message_size);
+    AppendLittleEndian(record, stream_offset);
+    AppendLittleEndian(record, timestamp_ns);
+}
@@ -0,0 +1,85 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "FrameQueue.h"
+
+#include <algorithm>
+
+FrameQueue::FrameQueue(size_t capacity, QueueOverflowPolicy overflow_policy, FrameBufferPool& buffer_pool)
+    : capacity_(std::max<size_t>(capacity, 1)), overflow_policy_(overflow_policy), buffer_pool_(buffer_pool), frames_(capacity_)
+{
+}
+
+bool FrameQueue::Push(std::unique_ptr<FrameBuffer> frame)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (size_ >= capacity_)
+    {
+        switch (overflow_policy_)
+        {
+            case QueueOverflowPolicy::kBlock:
+                not_full_.wait(lock, [this] { return size_ < capacity_ || closed_; });
+                break;
+            case QueueOverflowPolicy::kDropOldest:
+                buffer_pool_.Release(std::move(frames_[head_]));
+                head_ = (head_ + 1) % capacity_;
+                size_--;
+                num_dropped_++;
+                break;
+            case QueueOverflowPolicy::kError:
+                num_dropped_++;
+                buffer_pool_.Release(std::move(frame));
+                return false;
+        }
+    }
+    if (closed_)
+    {
+        buffer_pool_.Release(std::move(frame));
+        return false;
+    }
+    frames_[(head_ + size_) % capacity_] = std::move(frame);
+    size_++;
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+}
+
+bool FrameQueue::Pop(std::unique_ptr<FrameBuffer>& frame)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return size_ > 0 || closed_; });
+    if (size_ == 0)
+    {
+        return false;
+    }
+    frame = std::move(frames_[head_]);
+    head_ = (head_ + 1) % capacity_;
+    size_--;
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+void FrameQueue::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+}
+
+size_t FrameQueue::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+uint64_t FrameQueue::NumDropped() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_dropped_;
+}
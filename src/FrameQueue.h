@@ -0,0 +1,64 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "FrameBufferPool.h"
+
+enum class QueueOverflowPolicy : u_int8_t
+{
+    kBlock = 0,  /**< wait until the writer thread made room in the queue */
+    kDropOldest, /**< discard the oldest queued frame */
+    kError,      /**< reject the new frame */
+};
+
+/**
+ * Bounded FIFO of serialized frames between the simulation thread and the writer thread.
+ * Frames that are dropped or rejected are given back to the buffer pool.
+ */
+class FrameQueue
+{
+  public:
+    FrameQueue(size_t capacity, QueueOverflowPolicy overflow_policy, FrameBufferPool& buffer_pool);
+
+    /**
+     * Add a frame to the queue, applying the overflow policy if the queue is full.
+     *
+     * \return false if the frame was rejected or the queue is closed
+     */
+    bool Push(std::unique_ptr<FrameBuffer> frame);
+
+    /**
+     * Take the oldest frame from the queue, waiting until a frame is available.
+     *
+     * \return false if the queue is closed and empty
+     */
+    bool Pop(std::unique_ptr<FrameBuffer>& frame);
+
+    /** Stop accepting frames and wake up all waiting threads. Queued frames can still be popped. */
+    void Close();
+
+    size_t Size() const;
+    uint64_t NumDropped() const;
+
+  private:
+    const size_t capacity_;
+    const QueueOverflowPolicy overflow_policy_;
+    FrameBufferPool& buffer_pool_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::vector<std::unique_ptr<FrameBuffer>> frames_;  // ring buffer, preallocated to the capacity
+    size_t head_ = 0;
+    size_t size_ = 0;
+    uint64_t num_dropped_ = 0;
+    bool closed_ = false;
+};
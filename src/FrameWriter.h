@@ -0,0 +1,130 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "OsiWireFormat.h"
+#include "RawBinaryTraceFileWriter.h"
+#include "RawMCAPTraceFileWriter.h"
+#include "RawTXTHTraceFileWriter.h"
+#include "TraceFileWriter.h"
+
+/** Trace file writer class used for a file format */
+template <FileFormat F>
+struct FormatWriter
+{
+    using Type = RawBinaryTraceFileWriter;  // .osi, .osi.zst, .osi.lz4
+};
+
+template <>
+struct FormatWriter<FileFormat::MCAP>
+{
+    using Type = RawMCAPTraceFileWriter;
+};
+
+template <>
+struct FormatWriter<FileFormat::TXTH>
+{
+    using Type = RawTXTHTraceFileWriter;
+};
+
+/**
+ * Write path of one message type T to one file format F, resolved at compile time.
+ *
+ * MCAP and .osi store the serialized message as it is, so the OSMP input buffer is copied
+ * straight into the file without parsing it, the OSI version is read from the wire format.
+ * Only TXTH needs the parsed message, it is parsed and formatted by FormatTextFrame(), possibly on a worker thread.
+ */
+template <typename T, FileFormat F>
+class FrameWriter final : public IFrameWriter
+{
+  public:
+    using Writer = typename FormatWriter<F>::Type;
+
+    /**
+     * \param writer opened trace file writer of the format
+     * \param osi_version set to the OSI version of the first frame, used for the final file name. Only passed to the
+     *                    writer of the main input, nullptr for the others
+     * \param topic MCAP channel topic, created on the first frame
+     * \param log_time source of the MCAP log time
+     */
+    FrameWriter(Writer& writer, std::string* osi_version, std::string topic, McapLogTime log_time = McapLogTime::kOsiTimestamp)
+        : writer_(writer), osi_version_(osi_version), topic_(std::move(topic)), log_time_(log_time)
+    {
+    }
+
+    bool Write(const void* data, int size, double sim_time) override
+    {
+        // for the first time we receive a message, we need to extract the OSI version to add
+        // it to the mcap channel metadata (and thus create the channel on the first message)
+        // and add the OSI version the trace file name in the termination step
+        if (first_frame_)
+        {
+            first_frame_ = false;
+            WriteFirstFrame(data, size);
+        }
+
+        if constexpr (F == FileFormat::MCAP)
+        {
+            uint64_t osi_time = 0;
+            if (!ReadTimestampNanoseconds(data, size, osi_time))
+            {
+                return false;
+            }
+            // messages without an OSI timestamp are stamped with the simulation time, so every message can be found by time
+            const uint64_t sim_time_ns = sim_time > 0.0 ? static_cast<uint64_t>(std::llround(sim_time * 1e9)) : 0;
+            if (osi_time == 0)
+            {
+                osi_time = sim_time_ns;
+            }
+            const uint64_t log_time = log_time_ == McapLogTime::kSimulationTime ? sim_time_ns : osi_time;
+            return writer_.WriteFrame(mcap_channel_id_, data, size, log_time, osi_time);
+        }
+        else if constexpr (F == FileFormat::TXTH)
+        {
+            return writer_.WriteFrame(data, size, &FormatTextFrame<T>);
+        }
+        else
+        {
+            return writer_.WriteFrame(data, size);
+        }
+    }
+
+  private:
+    void WriteFirstFrame(const void* data, int size)
+    {
+        uint32_t major = 0;
+        uint32_t minor = 0;
+        uint32_t patch = 0;
+        if (!ReadInterfaceVersion(data, size, major, minor, patch) || (major == 0 && minor == 0 && patch == 0))
+        {
+            std::cerr << "Could not read the OSI version of the first message on " << topic_ << std::endl;
+        }
+        if (osi_version_ != nullptr)
+        {
+            *osi_version_ = std::to_string(major) + std::to_string(minor) + std::to_string(patch);
+        }
+        // create mcap channel if mcap writer
+        if constexpr (F == FileFormat::MCAP)
+        {
+            std::unordered_map<std::string, std::string> channel_metadata = {
+                {"net.asam.osi.trace.channel.description", "Channel added via openMSL sl-5-6-osi-trace-file-writer"},
+                {"net.asam.osi.trace.channel.osi_version", std::to_string(major) + "." + std::to_string(minor) + "." + std::to_string(patch)}};
+            mcap_channel_id_ = writer_.AddChannel(topic_, T::descriptor(), channel_metadata);
+        }
+    }
+
+    Writer& writer_;
+    std::string* osi_version_;
+    const std::string topic_;
+    const McapLogTime log_time_;
+    bool first_frame_ = true;
+    uint16_t mcap_channel_id_ = 0;
+};
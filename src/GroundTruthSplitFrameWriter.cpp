@@ -0,0 +1,109 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "GroundTruthSplitFrameWriter.h"
+
+#include <algorithm>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "FrameHash.h"
+#include "OsiWireFormat.h"
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace
+{
+/** GroundTruth fields that describe the (mostly) static map */
+const char* const kStaticFieldNames[] = {"lane", "lane_boundary", "logical_lane", "logical_lane_boundary", "reference_line", "stationary_object"};
+
+int FieldNumber(const char* name)
+{
+    const auto* field = osi3::GroundTruth::descriptor()->FindFieldByName(name);
+    return field != nullptr ? field->number() : 0;
+}
+}  // namespace
+
+GroundTruthSplitFrameWriter::GroundTruthSplitFrameWriter(RawMCAPTraceFileWriter& writer, std::string* osi_version, const std::string& topic, McapLogTime log_time)
+    : dynamic_writer_(writer, osi_version, topic, log_time),
+      static_writer_(writer, nullptr, topic + "/static", log_time)
+{
+    for (const char* name : kStaticFieldNames)
+    {
+        // fields that the OSI version in use does not have yet are skipped
+        if (const int field_number = FieldNumber(name); field_number != 0)
+        {
+            static_field_numbers_.push_back(field_number);
+        }
+    }
+}
+
+bool GroundTruthSplitFrameWriter::Write(const void* data, int size, double sim_time)
+{
+    if (!SplitFields(data, size))
+    {
+        return false;
+    }
+    if (!static_written_ || static_hash_ != last_static_hash_)
+    {
+        if (!static_writer_.Write(static_fields_.data(), static_cast<int>(static_fields_.size()), sim_time))
+        {
+            return false;
+        }
+        static_written_ = true;
+        last_static_hash_ = static_hash_;
+    }
+    return dynamic_writer_.Write(dynamic_fields_.data(), static_cast<int>(dynamic_fields_.size()), sim_time);
+}
+
+bool GroundTruthSplitFrameWriter::SplitFields(const void* data, int size)
+{
+    dynamic_fields_.clear();
+    static_fields_.clear();
+    static_hash_ = 0;
+
+    const auto* bytes = static_cast<const char*>(data);
+    google::protobuf::io::CodedInputStream input(static_cast<const uint8_t*>(data), size);
+    while (true)
+    {
+        const int field_start = input.CurrentPosition();
+        const uint32_t tag = input.ReadTag();
+        if (tag == 0)
+        {
+            break;
+        }
+        if (!WireFormatLite::SkipField(&input, tag))
+        {
+            return false;
+        }
+        const char* field = bytes + field_start;
+        const auto field_size = static_cast<size_t>(input.CurrentPosition() - field_start);
+
+        // version and timestamp go into both messages, they are not part of the static content hash
+        const int field_number = WireFormatLite::GetTagFieldNumber(tag);
+        if (field_number == kOsiVersionFieldNumber || field_number == kOsiTimestampFieldNumber)
+        {
+            dynamic_fields_.append(field, field_size);
+            static_fields_.append(field, field_size);
+        }
+        else if (IsStaticField(field_number))
+        {
+            static_fields_.append(field, field_size);
+            // each field is hashed with the hash of the previous fields as seed
+            static_hash_ = XxHash64(field, field_size, static_hash_);
+        }
+        else
+        {
+            dynamic_fields_.append(field, field_size);
+        }
+    }
+    return input.ConsumedEntireMessage();
+}
+
+bool GroundTruthSplitFrameWriter::IsStaticField(int field_number) const
+{
+    return std::find(static_field_numbers_.begin(), static_field_numbers_.end(), field_number) != static_field_numbers_.end();
+}
@@ -0,0 +1,45 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameWriter.h"
+#include "osi_groundtruth.pb.h"
+
+/**
+ * Records GroundTruth as two MCAP channels: the map content (lanes, lane boundaries, reference
+ * lines, stationary objects, ...) on "<topic>/static", written only when it changes, and all
+ * other fields on "<topic>" in every frame. Both are valid partial GroundTruth messages with
+ * version and timestamp, a reader merges a frame with the latest static message before it.
+ *
+ * The message is split by its top-level fields directly on the wire format, without parsing it.
+ * Changes of the static content are detected by hashing its serialized bytes.
+ */
+class GroundTruthSplitFrameWriter final : public IFrameWriter
+{
+  public:
+    GroundTruthSplitFrameWriter(RawMCAPTraceFileWriter& writer, std::string* osi_version, const std::string& topic, McapLogTime log_time);
+
+    bool Write(const void* data, int size, double sim_time) override;
+
+  private:
+    bool SplitFields(const void* data, int size);
+    bool IsStaticField(int field_number) const;
+
+    FrameWriter<osi3::GroundTruth, FileFormat::MCAP> dynamic_writer_;
+    FrameWriter<osi3::GroundTruth, FileFormat::MCAP> static_writer_;
+    std::vector<int> static_field_numbers_;
+
+    // reused for every frame
+    std::string dynamic_fields_;
+    std::string static_fields_;
+    uint64_t static_hash_ = 0;
+    uint64_t last_static_hash_ = 0;
+    bool static_written_ = false;
+};
@@ -0,0 +1,138 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifndef _WIN32
+
+bool MappedFile::Open(const std::filesystem::path& file_path, size_t extent_size)
+{
+    Close();
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    extent_size_ = std::max((extent_size + page_size - 1) / page_size * page_size, page_size);
+    allocated_size_ = 0;
+    written_size_ = 0;
+    fd_ = open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    return MapWindow(0);
+}
+
+bool MappedFile::Write(const void* data, size_t size)
+{
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    const auto* source = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        // a frame may span two windows, it is copied in pieces then
+        if (written_size_ >= window_offset_ + extent_size_ && !MapWindow(written_size_))
+        {
+            return false;
+        }
+        const auto window_position = static_cast<size_t>(written_size_ - window_offset_);
+        const size_t piece = std::min(size, extent_size_ - window_position);
+        std::memcpy(window_ + window_position, source, piece);
+        source += piece;
+        size -= piece;
+        written_size_ += piece;
+    }
+    return true;
+}
+
+bool MappedFile::Close()
+{
+    if (fd_ < 0)
+    {
+        return true;
+    }
+    UnmapWindow();
+    const bool truncated = ftruncate(fd_, static_cast<off_t>(written_size_)) == 0;
+    const bool closed = close(fd_) == 0;
+    fd_ = -1;
+    return truncated && closed;
+}
+
+bool MappedFile::MapWindow(uint64_t offset)
+{
+    UnmapWindow();
+    window_offset_ = offset / extent_size_ * extent_size_;
+    const uint64_t window_end = window_offset_ + extent_size_;
+    if (window_end > allocated_size_)
+    {
+#ifdef __linux__
+        const bool allocated = posix_fallocate(fd_, static_cast<off_t>(allocated_size_), static_cast<off_t>(window_end - allocated_size_)) == 0;
+#else
+        const bool allocated = ftruncate(fd_, static_cast<off_t>(window_end)) == 0;
+#endif
+        if (!allocated)
+        {
+            return false;
+        }
+        allocated_size_ = window_end;
+    }
+    void* window = mmap(nullptr, extent_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(window_offset_));
+    if (window == MAP_FAILED)
+    {
+        return false;
+    }
+    window_ = static_cast<char*>(window);
+    // the window is only written once from front to back
+    madvise(window_, extent_size_, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedFile::UnmapWindow()
+{
+    if (window_ != nullptr)
+    {
+        munmap(window_, extent_size_);
+        window_ = nullptr;
+    }
+}
+
+#else
+
+bool MappedFile::Open(const std::filesystem::path& /*file_path*/, size_t /*extent_size*/)
+{
+    return false;
+}
+
+bool MappedFile::Write(const void* /*data*/, size_t /*size*/)
+{
+    return false;
+}
+
+bool MappedFile::Close()
+{
+    return true;
+}
+
+bool MappedFile::MapWindow(uint64_t /*offset*/)
+{
+    return false;
+}
+
+void MappedFile::UnmapWindow() {}
+
+#endif
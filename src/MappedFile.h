@@ -0,0 +1,51 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * Output file that is written through a sliding memory mapped window instead of stream writes.
+ *
+ * The file is preallocated in large extents, so it grows in few steps and stays contiguous on disk.
+ * Data is copied straight into the mapping, without a stdio buffer copy and without a syscall per
+ * write. Close() truncates the file to the number of bytes actually written.
+ * Only available on POSIX systems, Open() fails otherwise.
+ */
+class MappedFile
+{
+  public:
+    static constexpr size_t kDefaultExtentSize = 64 * 1024 * 1024;
+
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * \param file_path file to create or truncate
+     * \param extent_size size of the preallocated extents and of the mapped window, rounded up to the page size
+     */
+    bool Open(const std::filesystem::path& file_path, size_t extent_size = kDefaultExtentSize);
+    bool IsOpen() const { return fd_ >= 0; }
+    bool Write(const void* data, size_t size);
+
+    /** Unmap the window and truncate the file to its written size */
+    bool Close();
+
+  private:
+    bool MapWindow(uint64_t offset);
+    void UnmapWindow();
+
+    int fd_ = -1;
+    size_t extent_size_ = 0;
+    uint64_t allocated_size_ = 0;
+    uint64_t written_size_ = 0;
+    char* window_ = nullptr;
+    uint64_t window_offset_ = 0;
+};
@@ -42,6 +42,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <limits>
 #include <string>
 
 using namespace std;
@@ -144,6 +145,11 @@ fmi2Status OSMP::DoInit()
 
     SetFmiOmitTimestamp(false);
 
+    // same as the start values of the model description, for importers that do not set them
+    SetFmiPreTriggerDuration(5.0);
+    SetFmiPostTriggerDuration(5.0);
+    SetFmiRecordEveryNth(1);
+
     return fmi2OK;
 }
 
@@ -176,34 +182,246 @@ fmi2Status OSMP::DoExitInitializationMode()
     }
 
     // determine format using map
-    const std::map<std::string, FileFormat> FORMAT_MAP = {{"osi", FileFormat::OSI}, {"mcap", FileFormat::MCAP}, {"txth", FileFormat::TXTH}};
+    const std::map<std::string, FileFormat> FORMAT_MAP = {
+        {"osi", FileFormat::OSI}, {"mcap", FileFormat::MCAP}, {"txth", FileFormat::TXTH}, {"osi.zst", FileFormat::OSI_ZST}, {"osi.lz4", FileFormat::OSI_LZ4}};
     const auto format_map_it = FORMAT_MAP.find(file_format_parameter);
     if (format_map_it == FORMAT_MAP.end())
     {
         std::cerr << "Unknown trace file format: " << FmiFileFormat() << std::endl;
         return fmi2Error;
     }
-    trace_file_writer_.Init(FmiTracePath(), FmiProtobufVersion(), FmiCustomName(), FmiMessageType(), format_map_it->second, FmiOmitTimestamp());
+
+    TraceFileWriterOptions options;
+    if (FmiWriteQueueDepth() < 0)
+    {
+        std::cerr << "Invalid write queue depth: " << FmiWriteQueueDepth() << std::endl;
+        return fmi2Error;
+    }
+    options.queue_depth = static_cast<size_t>(FmiWriteQueueDepth());
+
+    std::string queue_overflow_parameter = FmiWriteQueueOverflow();
+    std::transform(queue_overflow_parameter.begin(), queue_overflow_parameter.end(), queue_overflow_parameter.begin(), ::tolower);
+    const std::map<std::string, QueueOverflowPolicy> QUEUE_OVERFLOW_MAP = {
+        {"", QueueOverflowPolicy::kBlock}, {"block", QueueOverflowPolicy::kBlock}, {"drop_oldest", QueueOverflowPolicy::kDropOldest}, {"error", QueueOverflowPolicy::kError}};
+    const auto queue_overflow_map_it = QUEUE_OVERFLOW_MAP.find(queue_overflow_parameter);
+    if (queue_overflow_map_it == QUEUE_OVERFLOW_MAP.end())
+    {
+        std::cerr << "Unknown write queue overflow policy: " << FmiWriteQueueOverflow() << std::endl;
+        return fmi2Error;
+    }
+    options.queue_overflow_policy = queue_overflow_map_it->second;
+
+    std::string mcap_compression_parameter = FmiMcapCompression();
+    std::transform(mcap_compression_parameter.begin(), mcap_compression_parameter.end(), mcap_compression_parameter.begin(), ::tolower);
+    const std::map<std::string, McapCompression> MCAP_COMPRESSION_MAP = {
+        {"", McapCompression::kZstd}, {"zstd", McapCompression::kZstd}, {"lz4", McapCompression::kLz4}, {"none", McapCompression::kNone}};
+    const auto mcap_compression_map_it = MCAP_COMPRESSION_MAP.find(mcap_compression_parameter);
+    if (mcap_compression_map_it == MCAP_COMPRESSION_MAP.end())
+    {
+        std::cerr << "Unknown mcap compression: " << FmiMcapCompression() << std::endl;
+        return fmi2Error;
+    }
+    options.mcap_compression = mcap_compression_map_it->second;
+    options.mcap_compression_level = FmiMcapCompressionLevel();
+    std::string mcap_log_time_parameter = FmiMcapLogTime();
+    std::transform(mcap_log_time_parameter.begin(), mcap_log_time_parameter.end(), mcap_log_time_parameter.begin(), ::tolower);
+    const std::map<std::string, McapLogTime> MCAP_LOG_TIME_MAP = {
+        {"", McapLogTime::kOsiTimestamp}, {"osi_timestamp", McapLogTime::kOsiTimestamp}, {"simulation_time", McapLogTime::kSimulationTime}};
+    const auto mcap_log_time_map_it = MCAP_LOG_TIME_MAP.find(mcap_log_time_parameter);
+    if (mcap_log_time_map_it == MCAP_LOG_TIME_MAP.end())
+    {
+        std::cerr << "Unknown mcap log time: " << FmiMcapLogTime() << std::endl;
+        return fmi2Error;
+    }
+    options.mcap_log_time = mcap_log_time_map_it->second;
+    if (FmiMcapChunkSize() < 0)
+    {
+        std::cerr << "Invalid mcap chunk size: " << FmiMcapChunkSize() << std::endl;
+        return fmi2Error;
+    }
+    options.mcap_chunk_size = static_cast<uint64_t>(FmiMcapChunkSize());
+    if (FmiMcapCompressionThreads() < 0)
+    {
+        std::cerr << "Invalid number of mcap compression threads: " << FmiMcapCompressionThreads() << std::endl;
+        return fmi2Error;
+    }
+    options.mcap_compression_threads = static_cast<size_t>(FmiMcapCompressionThreads());
+    if (FmiTxthFormatThreads() < 0)
+    {
+        std::cerr << "Invalid number of txth format threads: " << FmiTxthFormatThreads() << std::endl;
+        return fmi2Error;
+    }
+    options.txth_format_threads = static_cast<size_t>(FmiTxthFormatThreads());
+    options.mmap_output = FmiMmapOutput() != 0;
+    options.io_uring_output = FmiIoUringOutput() != 0;
+    options.direct_io = FmiDirectIo() != 0;
+    options.osi_index = FmiOsiIndex() != 0;
+    if (FmiSegmentMaxSizeMb() < 0 || FmiSegmentMaxFrames() < 0 || FmiSegmentMaxDuration() < 0.0)
+    {
+        std::cerr << "Invalid trace file segment limit, segment_max_size_mb, segment_max_frames and segment_max_duration must not be negative" << std::endl;
+        return fmi2Error;
+    }
+    options.segment_max_bytes = static_cast<uint64_t>(FmiSegmentMaxSizeMb()) * 1024 * 1024;
+    options.segment_max_frames = static_cast<size_t>(FmiSegmentMaxFrames());
+    options.segment_max_duration = FmiSegmentMaxDuration();
+    if (FmiPreTriggerSizeMb() < 0 || FmiPreTriggerDuration() < 0.0 || FmiPostTriggerDuration() < 0.0)
+    {
+        std::cerr << "Invalid trigger window, pre_trigger_size_mb, pre_trigger_duration and post_trigger_duration must not be negative" << std::endl;
+        return fmi2Error;
+    }
+    options.trigger_mode = FmiTriggerMode() != 0;
+    options.pre_trigger_duration = FmiPreTriggerDuration();
+    options.pre_trigger_max_bytes = static_cast<uint64_t>(FmiPreTriggerSizeMb()) * 1024 * 1024;
+    options.post_trigger_duration = FmiPostTriggerDuration();
+    if (FmiRecordEveryNth() < 0 || FmiRecordInterval() < 0.0)
+    {
+        std::cerr << "Invalid frame decimation, record_every_nth and record_interval must not be negative" << std::endl;
+        return fmi2Error;
+    }
+    if (FmiCheckpointInterval() < 0.0)
+    {
+        std::cerr << "Invalid checkpoint_interval, must not be negative" << std::endl;
+        return fmi2Error;
+    }
+    options.checkpoint_interval = FmiCheckpointInterval();
+
+    // additional inputs are only recorded if their message type is set
+    options.topic = FmiTopic();
+    osi_inputs_ = {FMI_INTEGER_OSI_IN_BASELO_IDX};
+    for (int input = 0; input < FMI_OSI_IN_EXTRA_COUNT; input++)
+    {
+        if (FmiOsiInExtraMessageType(input).empty())
+        {
+            continue;
+        }
+        std::string topic = FmiOsiInExtraTopic(input);
+        if (topic.empty())
+        {
+            topic = "OSIIn" + std::to_string(input + 2);
+        }
+        options.additional_channels.push_back({FmiOsiInExtraMessageType(input), topic});
+        osi_inputs_.push_back(FMI_INTEGER_OSI_IN_EXTRA_OFFSET + 3 * input);
+    }
+    if (!options.additional_channels.empty() && format_map_it->second != FileFormat::MCAP)
+    {
+        std::cerr << "Additional OSI inputs can only be recorded into mcap trace files" << std::endl;
+        return fmi2Error;
+    }
+    options.split_static_ground_truth = FmiSplitStaticGroundTruth() != 0;
+    if (options.split_static_ground_truth && format_map_it->second != FileFormat::MCAP)
+    {
+        std::cerr << "Static GroundTruth content can only be split into separate channels of mcap trace files" << std::endl;
+        return fmi2Error;
+    }
+
+    options.field_mask = FmiFieldMask();
+    options.sink_name = FmiTraceSink();
+    if (FmiSinkRingSizeMb() < 0)
+    {
+        std::cerr << "Invalid trace sink ring size: " << FmiSinkRingSizeMb() << std::endl;
+        return fmi2Error;
+    }
+    options.sink_ring_bytes = static_cast<uint64_t>(FmiSinkRingSizeMb()) * 1024 * 1024;
+    options.deduplicate_frames = FmiDeduplicateFrames() != 0;
+
+    try
+    {
+        trace_file_writer_.Init(FmiTracePath(), FmiProtobufVersion(), FmiCustomName(), FmiMessageType(), format_map_it->second, FmiOmitTimestamp(), options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Could not initialize trace file writer: " << e.what() << std::endl;
+        return fmi2Error;
+    }
 
     return fmi2OK;
 }
 
 fmi2Status OSMP::DoCalc(fmi2Real current_communication_point, fmi2Real communication_step_size, fmi2Boolean no_set_fmu_state_prior_to_current_pointfmi_2_component)
 {
-    if (const void* buffer = DecodeIntegerToPointer(integer_vars_[FMI_INTEGER_OSI_IN_BASEHI_IDX], integer_vars_[FMI_INTEGER_OSI_IN_BASELO_IDX]);
-        !trace_file_writer_.Step(buffer, integer_vars_[FMI_INTEGER_OSI_IN_SIZE_IDX]))
+    // trigger before the step, so the triggering frame directly follows the pre-trigger frames
+    if (FmiTrigger() && !trace_file_writer_.Trigger(current_communication_point))
     {
         SetFmiValid(0);
-        NormalLog("OSI", "Could not write to trace file.");
+        NormalLog("OSI", "Could not write pre-trigger frames to trace file.");
         return fmi2Error;
     }
+    if (!IsFrameRecorded(current_communication_point))
+    {
+        return fmi2OK;
+    }
+    for (size_t channel = 0; channel < osi_inputs_.size(); channel++)
+    {
+        const int input = osi_inputs_[channel];
+        if (const void* buffer = DecodeIntegerToPointer(integer_vars_[input + 1], integer_vars_[input]);
+            !trace_file_writer_.Step(buffer, integer_vars_[input + 2], current_communication_point, channel))
+        {
+            SetFmiValid(0);
+            NormalLog("OSI", "Could not write to trace file.");
+            return fmi2Error;
+        }
+    }
     SetFmiValid(1);
+    SetFmiFramePoolHighWaterMark(static_cast<fmi2Integer>(trace_file_writer_.FramePoolHighWaterMark()));
+    SetFmiStatistics(trace_file_writer_.Statistics());
     return fmi2OK;
 }
 
+void OSMP::SetFmiStatistics(const TraceFileWriterStatistics& statistics)
+{
+    // fmi2Integer is 32 bit, the byte count is reported as a real to not overflow on long recordings
+    constexpr auto kIntegerMax = static_cast<uint64_t>(std::numeric_limits<fmi2Integer>::max());
+    SetFmiStepTimeLast(statistics.last_step_seconds);
+    SetFmiStepTimeMean(statistics.mean_step_seconds);
+    SetFmiStepTimeMax(statistics.max_step_seconds);
+    SetFmiBytesWritten(static_cast<fmi2Real>(statistics.bytes_written));
+    SetFmiFramesWritten(static_cast<fmi2Integer>(std::min(statistics.frames_written, kIntegerMax)));
+    SetFmiFramesDropped(static_cast<fmi2Integer>(std::min(statistics.frames_dropped, kIntegerMax)));
+    SetFmiFramesDeduplicated(static_cast<fmi2Integer>(std::min(statistics.frames_deduplicated, kIntegerMax)));
+    SetFmiWriteQueueSize(static_cast<fmi2Integer>(std::min<uint64_t>(statistics.queue_size, kIntegerMax)));
+}
+
+bool OSMP::IsFrameRecorded(fmi2Real current_communication_point)
+{
+    // only looks at the step counter and the simulation time, a skipped frame is not touched at all
+    const auto every_nth = static_cast<uint64_t>(FmiRecordEveryNth());
+    if (every_nth > 1 && step_count_++ % every_nth != 0)
+    {
+        return false;
+    }
+    const double interval = FmiRecordInterval();
+    if (interval > 0.0)
+    {
+        if (!record_time_started_)
+        {
+            next_record_time_ = current_communication_point;
+            record_time_started_ = true;
+        }
+        if (current_communication_point < next_record_time_ - kRecordTimeTolerance)
+        {
+            return false;
+        }
+        // stay on the sampling grid of the first recorded frame, instead of accumulating step size jitter
+        while (next_record_time_ <= current_communication_point + kRecordTimeTolerance)
+        {
+            next_record_time_ += interval;
+        }
+    }
+    return true;
+}
+
 fmi2Status OSMP::DoTerm()
 {
     trace_file_writer_.Term();
+    const TraceFileWriterStatistics statistics = trace_file_writer_.Statistics();
+    SetFmiStatistics(statistics);
+    NormalLog("OSI",
+              "Recorded %llu frames (%llu bytes), %llu dropped. Step time mean %.6f s, max %.6f s.",
+              static_cast<unsigned long long>(statistics.frames_written),
+              static_cast<unsigned long long>(statistics.bytes_written),
+              static_cast<unsigned long long>(statistics.frames_dropped),
+              statistics.mean_step_seconds,
+              statistics.max_step_seconds);
     return fmi2OK;
 }
 
@@ -40,19 +40,56 @@
 /* Boolean Variables */
 #define FMI_BOOLEAN_VALID_IDX 0
 #define FMI_BOOLEAN_OMIT_TIMESTAMP_IDX 1
-#define FMI_BOOLEAN_LAST_IDX FMI_BOOLEAN_OMIT_TIMESTAMP_IDX
+#define FMI_BOOLEAN_MMAP_OUTPUT_IDX 2
+#define FMI_BOOLEAN_TRIGGER_IDX 3
+#define FMI_BOOLEAN_TRIGGER_MODE_IDX 4
+#define FMI_BOOLEAN_OSI_INDEX_IDX 5
+#define FMI_BOOLEAN_SPLIT_STATIC_GROUND_TRUTH_IDX 6
+#define FMI_BOOLEAN_IO_URING_OUTPUT_IDX 7
+#define FMI_BOOLEAN_DIRECT_IO_IDX 8
+#define FMI_BOOLEAN_DEDUPLICATE_FRAMES_IDX 9
+#define FMI_BOOLEAN_LAST_IDX FMI_BOOLEAN_DEDUPLICATE_FRAMES_IDX
 #define FMI_BOOLEAN_VARS (FMI_BOOLEAN_LAST_IDX + 1)
 
+/* Additional OSI inputs OSIIn2 to OSIIn4, recorded as further channels of an mcap trace file */
+#define FMI_OSI_IN_EXTRA_COUNT 3
+
 /* Integer Variables */
 #define FMI_INTEGER_OSI_IN_BASELO_IDX 0
 #define FMI_INTEGER_OSI_IN_BASEHI_IDX 1
 #define FMI_INTEGER_OSI_IN_SIZE_IDX 2
-#define FMI_INTEGER_LAST_IDX FMI_INTEGER_OSI_IN_SIZE_IDX
+#define FMI_INTEGER_WRITE_QUEUE_DEPTH_IDX 3
+#define FMI_INTEGER_FRAME_POOL_HIGH_WATER_MARK_IDX 4
+#define FMI_INTEGER_MCAP_COMPRESSION_LEVEL_IDX 5
+#define FMI_INTEGER_MCAP_CHUNK_SIZE_IDX 6
+#define FMI_INTEGER_MCAP_COMPRESSION_THREADS_IDX 7
+#define FMI_INTEGER_SEGMENT_MAX_SIZE_MB_IDX 8
+#define FMI_INTEGER_SEGMENT_MAX_FRAMES_IDX 9
+#define FMI_INTEGER_PRE_TRIGGER_SIZE_MB_IDX 10
+#define FMI_INTEGER_RECORD_EVERY_NTH_IDX 11
+#define FMI_INTEGER_OSI_IN_EXTRA_OFFSET 12 /* base.lo, base.hi and size of each additional input */
+#define FMI_INTEGER_OSI_IN_EXTRA_SIZE (3 * FMI_OSI_IN_EXTRA_COUNT)
+#define FMI_INTEGER_FRAMES_WRITTEN_IDX (FMI_INTEGER_OSI_IN_EXTRA_OFFSET + FMI_INTEGER_OSI_IN_EXTRA_SIZE)
+#define FMI_INTEGER_FRAMES_DROPPED_IDX (FMI_INTEGER_FRAMES_WRITTEN_IDX + 1)
+#define FMI_INTEGER_WRITE_QUEUE_SIZE_IDX (FMI_INTEGER_FRAMES_DROPPED_IDX + 1)
+#define FMI_INTEGER_TXTH_FORMAT_THREADS_IDX (FMI_INTEGER_WRITE_QUEUE_SIZE_IDX + 1)
+#define FMI_INTEGER_FRAMES_DEDUPLICATED_IDX (FMI_INTEGER_TXTH_FORMAT_THREADS_IDX + 1)
+#define FMI_INTEGER_SINK_RING_SIZE_MB_IDX (FMI_INTEGER_FRAMES_DEDUPLICATED_IDX + 1)
+#define FMI_INTEGER_LAST_IDX FMI_INTEGER_SINK_RING_SIZE_MB_IDX
 #define FMI_INTEGER_VARS (FMI_INTEGER_LAST_IDX + 1)
 
 /* Real Variables */
 #define FMI_REAL_NOMINAL_RANGE_IDX 0
-#define FMI_REAL_LAST_IDX FMI_REAL_NOMINAL_RANGE_IDX
+#define FMI_REAL_SEGMENT_MAX_DURATION_IDX 1
+#define FMI_REAL_PRE_TRIGGER_DURATION_IDX 2
+#define FMI_REAL_POST_TRIGGER_DURATION_IDX 3
+#define FMI_REAL_RECORD_INTERVAL_IDX 4
+#define FMI_REAL_STEP_TIME_LAST_IDX 5
+#define FMI_REAL_STEP_TIME_MEAN_IDX 6
+#define FMI_REAL_STEP_TIME_MAX_IDX 7
+#define FMI_REAL_BYTES_WRITTEN_IDX 8
+#define FMI_REAL_CHECKPOINT_INTERVAL_IDX 9
+#define FMI_REAL_LAST_IDX FMI_REAL_CHECKPOINT_INTERVAL_IDX
 #define FMI_REAL_VARS (FMI_REAL_LAST_IDX + 1)
 
 /* String Variables */
@@ -61,7 +98,15 @@
 #define FMI_STRING_CUSTOM_NAME_IDX 2
 #define FMI_STRING_MESSAGE_TYPE_IDX 3
 #define FMI_STRING_FILE_FORMAT_IDX 4
-#define FMI_STRING_LAST_IDX FMI_STRING_FILE_FORMAT_IDX
+#define FMI_STRING_WRITE_QUEUE_OVERFLOW_IDX 5
+#define FMI_STRING_MCAP_COMPRESSION_IDX 6
+#define FMI_STRING_TOPIC_IDX 7
+#define FMI_STRING_OSI_IN_EXTRA_OFFSET 8 /* message type and topic of each additional input */
+#define FMI_STRING_OSI_IN_EXTRA_SIZE (2 * FMI_OSI_IN_EXTRA_COUNT)
+#define FMI_STRING_MCAP_LOG_TIME_IDX (FMI_STRING_OSI_IN_EXTRA_OFFSET + FMI_STRING_OSI_IN_EXTRA_SIZE)
+#define FMI_STRING_FIELD_MASK_IDX (FMI_STRING_MCAP_LOG_TIME_IDX + 1)
+#define FMI_STRING_TRACE_SINK_IDX (FMI_STRING_FIELD_MASK_IDX + 1)
+#define FMI_STRING_LAST_IDX FMI_STRING_TRACE_SINK_IDX
 #define FMI_STRING_VARS (FMI_STRING_LAST_IDX + 1)
 
 #include <cstdarg>
@@ -69,6 +114,7 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <vector>
 
 #undef min
 #undef max
@@ -168,13 +214,13 @@ class OSMP
         if (private_log_file.is_open())
         {
             private_log_file << "OSMPDummySensor"
-                             << "::" << instanceName << "<" << ((void*)this) << ">:" << category << ": " << buffer << endl;
+                             << "::" << instance_name_ << "<" << ((void*)this) << ">:" << category << ": " << buffer << endl;
             private_log_file.flush();
         }
 #endif
 #ifdef PUBLIC_LOGGING
-        if (loggingOn && loggingCategories.count(category))
-            functions.logger(functions.componentEnvironment, instanceName.c_str(), fmi2OK, category, buffer);
+        if (logging_on_ && logging_categories_.count(category))
+            functions_.logger(functions_.componentEnvironment, instance_name_.c_str(), fmi2OK, category, buffer);
 #endif
 #endif
     }
@@ -184,7 +230,7 @@ class OSMP
 #if defined(VERBOSE_FMI_LOGGING) && (defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING))
         va_list ap;
         va_start(ap, format);
-        internal_log("FMI", format, ap);
+        InternalLog("FMI", format, ap);
         va_end(ap);
 #endif
     }
@@ -195,7 +241,7 @@ class OSMP
 #if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
         va_list ap;
         va_start(ap, format);
-        internal_log(category, format, ap);
+        InternalLog(category, format, ap);
         va_end(ap);
 #endif
     }
@@ -218,17 +264,73 @@ class OSMP
 
     TraceFileWriter trace_file_writer_;
 
+    /* Integer variable offsets (base.lo, base.hi, size) of the recorded inputs, indexed by trace file channel */
+    vector<int> osi_inputs_;
+
+    /* Frame decimation */
+    static constexpr double kRecordTimeTolerance = 1e-6;
+    uint64_t step_count_ = 0;
+    double next_record_time_ = 0.0;
+    bool record_time_started_ = false;
+    bool IsFrameRecorded(fmi2Real current_communication_point);
+
+    /* Recording statistics outputs */
+    void SetFmiStatistics(const TraceFileWriterStatistics& statistics);
+
     /* Simple Accessors */
     fmi2Boolean FmiValid() { return boolean_vars_[FMI_BOOLEAN_VALID_IDX]; }
     void SetFmiValid(fmi2Boolean value) { boolean_vars_[FMI_BOOLEAN_VALID_IDX] = value; }
     fmi2Boolean FmiOmitTimestamp() { return boolean_vars_[FMI_BOOLEAN_OMIT_TIMESTAMP_IDX]; }
     void SetFmiOmitTimestamp(fmi2Boolean value) { boolean_vars_[FMI_BOOLEAN_OMIT_TIMESTAMP_IDX] = value; }
+    fmi2Boolean FmiMmapOutput() { return boolean_vars_[FMI_BOOLEAN_MMAP_OUTPUT_IDX]; }
+    fmi2Boolean FmiIoUringOutput() { return boolean_vars_[FMI_BOOLEAN_IO_URING_OUTPUT_IDX]; }
+    fmi2Boolean FmiDirectIo() { return boolean_vars_[FMI_BOOLEAN_DIRECT_IO_IDX]; }
+    fmi2Boolean FmiDeduplicateFrames() { return boolean_vars_[FMI_BOOLEAN_DEDUPLICATE_FRAMES_IDX]; }
+    fmi2Boolean FmiTrigger() { return boolean_vars_[FMI_BOOLEAN_TRIGGER_IDX]; }
+    fmi2Boolean FmiTriggerMode() { return boolean_vars_[FMI_BOOLEAN_TRIGGER_MODE_IDX]; }
+    fmi2Boolean FmiOsiIndex() { return boolean_vars_[FMI_BOOLEAN_OSI_INDEX_IDX]; }
+    fmi2Boolean FmiSplitStaticGroundTruth() { return boolean_vars_[FMI_BOOLEAN_SPLIT_STATIC_GROUND_TRUTH_IDX]; }
     string FmiTracePath() { return string_vars_[FMI_STRING_TRACE_PATH_IDX]; }
     void SetFmiTracePath(string value) { string_vars_[FMI_STRING_TRACE_PATH_IDX] = value; }
     string FmiProtobufVersion() { return string_vars_[FMI_STRING_PROTOBUF_VERSION_IDX]; }
     string FmiCustomName() { return string_vars_[FMI_STRING_CUSTOM_NAME_IDX]; }
     string FmiMessageType() { return string_vars_[FMI_STRING_MESSAGE_TYPE_IDX]; }
     string FmiFileFormat() { return string_vars_[FMI_STRING_FILE_FORMAT_IDX]; }
+    fmi2Integer FmiWriteQueueDepth() { return integer_vars_[FMI_INTEGER_WRITE_QUEUE_DEPTH_IDX]; }
+    string FmiWriteQueueOverflow() { return string_vars_[FMI_STRING_WRITE_QUEUE_OVERFLOW_IDX]; }
+    void SetFmiFramePoolHighWaterMark(fmi2Integer value) { integer_vars_[FMI_INTEGER_FRAME_POOL_HIGH_WATER_MARK_IDX] = value; }
+    string FmiMcapCompression() { return string_vars_[FMI_STRING_MCAP_COMPRESSION_IDX]; }
+    string FmiMcapLogTime() { return string_vars_[FMI_STRING_MCAP_LOG_TIME_IDX]; }
+    string FmiFieldMask() { return string_vars_[FMI_STRING_FIELD_MASK_IDX]; }
+    string FmiTopic() { return string_vars_[FMI_STRING_TOPIC_IDX]; }
+    string FmiTraceSink() { return string_vars_[FMI_STRING_TRACE_SINK_IDX]; }
+    string FmiOsiInExtraMessageType(int input) { return string_vars_[FMI_STRING_OSI_IN_EXTRA_OFFSET + 2 * input]; }
+    string FmiOsiInExtraTopic(int input) { return string_vars_[FMI_STRING_OSI_IN_EXTRA_OFFSET + 2 * input + 1]; }
+    fmi2Integer FmiMcapCompressionLevel() { return integer_vars_[FMI_INTEGER_MCAP_COMPRESSION_LEVEL_IDX]; }
+    fmi2Integer FmiMcapChunkSize() { return integer_vars_[FMI_INTEGER_MCAP_CHUNK_SIZE_IDX]; }
+    fmi2Integer FmiMcapCompressionThreads() { return integer_vars_[FMI_INTEGER_MCAP_COMPRESSION_THREADS_IDX]; }
+    fmi2Integer FmiTxthFormatThreads() { return integer_vars_[FMI_INTEGER_TXTH_FORMAT_THREADS_IDX]; }
+    fmi2Integer FmiSinkRingSizeMb() { return integer_vars_[FMI_INTEGER_SINK_RING_SIZE_MB_IDX]; }
+    fmi2Integer FmiSegmentMaxSizeMb() { return integer_vars_[FMI_INTEGER_SEGMENT_MAX_SIZE_MB_IDX]; }
+    fmi2Integer FmiSegmentMaxFrames() { return integer_vars_[FMI_INTEGER_SEGMENT_MAX_FRAMES_IDX]; }
+    fmi2Real FmiSegmentMaxDuration() { return real_vars_[FMI_REAL_SEGMENT_MAX_DURATION_IDX]; }
+    fmi2Integer FmiPreTriggerSizeMb() { return integer_vars_[FMI_INTEGER_PRE_TRIGGER_SIZE_MB_IDX]; }
+    fmi2Real FmiPreTriggerDuration() { return real_vars_[FMI_REAL_PRE_TRIGGER_DURATION_IDX]; }
+    void SetFmiPreTriggerDuration(fmi2Real value) { real_vars_[FMI_REAL_PRE_TRIGGER_DURATION_IDX] = value; }
+    fmi2Real FmiPostTriggerDuration() { return real_vars_[FMI_REAL_POST_TRIGGER_DURATION_IDX]; }
+    void SetFmiPostTriggerDuration(fmi2Real value) { real_vars_[FMI_REAL_POST_TRIGGER_DURATION_IDX] = value; }
+    fmi2Integer FmiRecordEveryNth() { return integer_vars_[FMI_INTEGER_RECORD_EVERY_NTH_IDX]; }
+    void SetFmiRecordEveryNth(fmi2Integer value) { integer_vars_[FMI_INTEGER_RECORD_EVERY_NTH_IDX] = value; }
+    fmi2Real FmiRecordInterval() { return real_vars_[FMI_REAL_RECORD_INTERVAL_IDX]; }
+    fmi2Real FmiCheckpointInterval() { return real_vars_[FMI_REAL_CHECKPOINT_INTERVAL_IDX]; }
+    void SetFmiStepTimeLast(fmi2Real value) { real_vars_[FMI_REAL_STEP_TIME_LAST_IDX] = value; }
+    void SetFmiStepTimeMean(fmi2Real value) { real_vars_[FMI_REAL_STEP_TIME_MEAN_IDX] = value; }
+    void SetFmiStepTimeMax(fmi2Real value) { real_vars_[FMI_REAL_STEP_TIME_MAX_IDX] = value; }
+    void SetFmiBytesWritten(fmi2Real value) { real_vars_[FMI_REAL_BYTES_WRITTEN_IDX] = value; }
+    void SetFmiFramesWritten(fmi2Integer value) { integer_vars_[FMI_INTEGER_FRAMES_WRITTEN_IDX] = value; }
+    void SetFmiFramesDropped(fmi2Integer value) { integer_vars_[FMI_INTEGER_FRAMES_DROPPED_IDX] = value; }
+    void SetFmiFramesDeduplicated(fmi2Integer value) { integer_vars_[FMI_INTEGER_FRAMES_DEDUPLICATED_IDX] = value; }
+    void SetFmiWriteQueueSize(fmi2Integer value) { integer_vars_[FMI_INTEGER_WRITE_QUEUE_SIZE_IDX] = value; }
 
     /* Protocol Buffer Accessors */
     bool GetFmiSensorDataIn(osi3::SensorData& data);
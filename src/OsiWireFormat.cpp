@@ -0,0 +1,85 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "OsiWireFormat.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace
+{
+/**
+ * Read the varint fields 1 to num_values of the top-level sub-message field_number, walking only
+ * the top-level tags. Values of fields that are not set stay 0.
+ */
+bool ReadSubMessageVarints(const void* data, int size, int field_number, uint64_t* values, int num_values)
+{
+    for (int i = 0; i < num_values; i++)
+    {
+        values[i] = 0;
+    }
+    google::protobuf::io::CodedInputStream input(static_cast<const uint8_t*>(data), size);
+    while (const uint32_t tag = input.ReadTag())
+    {
+        if (WireFormatLite::GetTagFieldNumber(tag) != field_number || WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+        {
+            if (!WireFormatLite::SkipField(&input, tag))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        int length = 0;
+        // a negative or too long length is malformed, a truncated sub-message would silently end at the end of the data
+        if (!input.ReadVarintSizeAsInt(&length) || length < 0 || length > size - input.CurrentPosition())
+        {
+            return false;
+        }
+        const auto limit = input.PushLimit(length);
+        while (const uint32_t sub_tag = input.ReadTag())
+        {
+            const int sub_field_number = WireFormatLite::GetTagFieldNumber(sub_tag);
+            const bool is_varint = WireFormatLite::GetTagWireType(sub_tag) == WireFormatLite::WIRETYPE_VARINT;
+            if (sub_field_number >= 1 && sub_field_number <= num_values && is_varint)
+            {
+                if (!input.ReadVarint64(&values[sub_field_number - 1]))
+                {
+                    return false;
+                }
+            }
+            else if (!WireFormatLite::SkipField(&input, sub_tag))
+            {
+                return false;
+            }
+        }
+        input.PopLimit(limit);
+        return true;
+    }
+    return input.ConsumedEntireMessage();
+}
+}  // namespace
+
+bool ReadTimestampNanoseconds(const void* data, int size, uint64_t& timestamp_ns)
+{
+    // osi3::Timestamp: seconds (1, int64), nanos (2, uint32)
+    uint64_t values[2];
+    const bool success = ReadSubMessageVarints(data, size, kOsiTimestampFieldNumber, values, 2);
+    timestamp_ns = values[0] * 1000000000ULL + static_cast<uint32_t>(values[1]);
+    return success;
+}
+
+bool ReadInterfaceVersion(const void* data, int size, uint32_t& major, uint32_t& minor, uint32_t& patch)
+{
+    // osi3::InterfaceVersion: version_major (1), version_minor (2), version_patch (3), all uint32
+    uint64_t values[3];
+    const bool success = ReadSubMessageVarints(data, size, kOsiVersionFieldNumber, values, 3);
+    major = static_cast<uint32_t>(values[0]);
+    minor = static_cast<uint32_t>(values[1]);
+    patch = static_cast<uint32_t>(values[2]);
+    return success;
+}
@@ -0,0 +1,38 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Helpers to read single top-level fields of a serialized OSI message (SensorView,
+ * SensorData, GroundTruth) directly from the wire format without parsing the whole message.
+ */
+
+/** Field number of the interface version in all supported OSI top-level messages */
+constexpr int kOsiVersionFieldNumber = 1;
+/** Field number of the timestamp in all supported OSI top-level messages */
+constexpr int kOsiTimestampFieldNumber = 2;
+
+/**
+ * Read the OSI timestamp of a serialized top-level message.
+ *
+ * \param data serialized message
+ * \param size size of the serialized message in bytes
+ * \param timestamp_ns timestamp in nanoseconds, 0 if the message has no timestamp
+ * \return false if the wire format is malformed
+ */
+bool ReadTimestampNanoseconds(const void* data, int size, uint64_t& timestamp_ns);
+
+/**
+ * Read the OSI interface version of a serialized top-level message.
+ *
+ * \param data serialized message
+ * \param size size of the serialized message in bytes
+ * \param major, minor, patch version numbers, 0 if the message has no version
+ * \return false if the wire format is malformed
+ */
+bool ReadInterfaceVersion(const void* data, int size, uint32_t& major, uint32_t& minor, uint32_t& patch);
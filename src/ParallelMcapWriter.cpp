@@ -0,0 +1,326 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "ParallelMcapWriter.h"
+
+#include <algorithm>
+#include <system_error>
+
+namespace
+{
+std::string CompressionName(mcap::Compression compression)
+{
+    switch (compression)
+    {
+        case mcap::Compression::Zstd:
+            return "zstd";
+        case mcap::Compression::Lz4:
+            return "lz4";
+        default:
+            return "";
+    }
+}
+
+/** Collects records that would be written to the output at offset, e.g. a summary section that is not written yet */
+class OffsetBufferWriter final : public mcap::IWritable
+{
+  public:
+    OffsetBufferWriter(uint64_t offset, std::string& buffer) : offset_(offset), buffer_(buffer) {}
+    void handleWrite(const std::byte* data, uint64_t size) override { buffer_.append(reinterpret_cast<const char*>(data), static_cast<size_t>(size)); }
+    void end() override {}
+    uint64_t size() const override { return offset_ + buffer_.size(); }
+
+  private:
+    const uint64_t offset_;
+    std::string& buffer_;
+};
+}  // namespace
+
+ParallelMcapWriter::~ParallelMcapWriter()
+{
+    Close();
+}
+
+mcap::Status ParallelMcapWriter::Open(std::string_view file_name, const mcap::McapWriterOptions& options, size_t num_threads)
+{
+    auto status = file_writer_.open(file_name);
+    if (!status.ok())
+    {
+        return status;
+    }
+    status = Open(file_writer_, options, num_threads);
+    if (!status.ok())
+    {
+        file_writer_.end();
+    }
+    return status;
+}
+
+mcap::Status ParallelMcapWriter::Open(mcap::IWritable& output, const mcap::McapWriterOptions& options, size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        return mcap::Status(mcap::StatusCode::OpenFailed);
+    }
+    try
+    {
+        compression_pool_ = std::make_unique<WorkerPool>(num_threads);
+    }
+    catch (const std::system_error&)
+    {
+        return mcap::Status(mcap::StatusCode::OpenFailed);
+    }
+    output_ = &output;
+    file_open_ = true;
+    options_ = options;
+
+    mcap::McapWriter::writeMagic(*output_);
+    mcap::McapWriter::write(*output_, mcap::Header{options_.profile, options_.library});
+    return {};
+}
+
+void ParallelMcapWriter::AddSchema(mcap::Schema& schema)
+{
+    schema.id = static_cast<mcap::SchemaId>(schemas_.size() + 1);
+    schemas_.push_back(schema);
+    statistics_.schemaCount++;
+}
+
+void ParallelMcapWriter::AddChannel(mcap::Channel& channel)
+{
+    channel.id = static_cast<mcap::ChannelId>(channels_.size() + 1);
+    channels_.push_back(channel);
+    statistics_.channelCount++;
+}
+
+mcap::Status ParallelMcapWriter::Write(const mcap::Message& message)
+{
+    if (!file_open_ || message.channelId == 0 || message.channelId > channels_.size())
+    {
+        return mcap::Status(mcap::StatusCode::InvalidChannelId);
+    }
+    if (!current_chunk_)
+    {
+        current_chunk_ = AcquireChunk();
+    }
+    auto& chunk = *current_chunk_;
+    if (chunk.message_indices.empty())
+    {
+        chunk.message_start_time = message.logTime;
+        chunk.message_end_time = message.logTime;
+    }
+
+    // every chunk carries the schema and channel records of its messages
+    const auto& channel = channels_[message.channelId - 1];
+    if (channel.schemaId != 0 && chunk.written_schemas.insert(channel.schemaId).second)
+    {
+        mcap::McapWriter::write(*chunk.records, schemas_[channel.schemaId - 1]);
+    }
+    if (chunk.written_channels.insert(channel.id).second)
+    {
+        mcap::McapWriter::write(*chunk.records, channel);
+    }
+
+    auto& message_index = chunk.message_indices[message.channelId];
+    message_index.channelId = message.channelId;
+    message_index.records.emplace_back(message.logTime, chunk.records->size());
+    mcap::McapWriter::write(*chunk.records, message);
+
+    chunk.message_start_time = std::min(chunk.message_start_time, message.logTime);
+    chunk.message_end_time = std::max(chunk.message_end_time, message.logTime);
+
+    if (statistics_.messageCount == 0)
+    {
+        statistics_.messageStartTime = message.logTime;
+        statistics_.messageEndTime = message.logTime;
+    }
+    statistics_.messageCount++;
+    statistics_.channelMessageCounts[message.channelId]++;
+    statistics_.messageStartTime = std::min(statistics_.messageStartTime, message.logTime);
+    statistics_.messageEndTime = std::max(statistics_.messageEndTime, message.logTime);
+
+    if (chunk.records->size() >= options_.chunkSize)
+    {
+        SubmitCurrentChunk();
+        // keep a bounded number of chunks in flight, so memory use does not grow if the disk is slower than the simulation
+        WriteCompressedChunks(2 * compression_pool_->NumThreads());
+    }
+    return {};
+}
+
+mcap::Status ParallelMcapWriter::Write(const mcap::Metadata& metadata)
+{
+    if (!file_open_)
+    {
+        return mcap::Status(mcap::StatusCode::NotOpen);
+    }
+    // metadata records are written between chunks, pending chunks must not end up behind it
+    SubmitCurrentChunk();
+    WriteCompressedChunks(0);
+
+    mcap::MetadataIndex metadata_index;
+    metadata_index.offset = output_->size();
+    metadata_index.length = mcap::McapWriter::write(*output_, metadata);
+    metadata_index.name = metadata.name;
+    metadata_indices_.push_back(metadata_index);
+    statistics_.metadataCount++;
+    return {};
+}
+
+void ParallelMcapWriter::Close()
+{
+    if (!file_open_)
+    {
+        return;
+    }
+    SubmitCurrentChunk();
+    WriteCompressedChunks(0);
+    compression_pool_.reset();
+    WriteSummary(*output_);
+    output_->end();
+    file_open_ = false;
+}
+
+uint64_t ParallelMcapWriter::Checkpoint(std::string& tail)
+{
+    SubmitCurrentChunk();
+    WriteCompressedChunks(0);
+    if (output_ == &file_writer_)
+    {
+        file_writer_.flush();
+    }
+    const uint64_t data_end = output_->size();
+    tail.clear();
+    OffsetBufferWriter tail_writer(data_end, tail);
+    WriteSummary(tail_writer);
+    return data_end;
+}
+
+std::unique_ptr<ParallelMcapWriter::Chunk> ParallelMcapWriter::AcquireChunk()
+{
+    if (!free_chunks_.empty())
+    {
+        auto chunk = std::move(free_chunks_.back());
+        free_chunks_.pop_back();
+        return chunk;
+    }
+
+    auto chunk = std::make_unique<Chunk>();
+    switch (options_.compression)
+    {
+        case mcap::Compression::Zstd:
+            chunk->records = std::make_unique<mcap::ZStdWriter>(options_.compressionLevel, options_.chunkSize);
+            break;
+        case mcap::Compression::Lz4:
+            chunk->records = std::make_unique<mcap::LZ4Writer>(options_.compressionLevel, options_.chunkSize);
+            break;
+        default:
+            chunk->records = std::make_unique<mcap::BufferWriter>();
+            break;
+    }
+    return chunk;
+}
+
+void ParallelMcapWriter::SubmitCurrentChunk()
+{
+    if (!current_chunk_ || current_chunk_->records->empty())
+    {
+        return;
+    }
+    auto* records = current_chunk_->records.get();
+    current_chunk_->uncompressed_size = records->size();
+    current_chunk_->compressed = compression_pool_->Submit([records] { records->end(); });
+    pending_chunks_.push_back(std::move(current_chunk_));
+}
+
+void ParallelMcapWriter::WriteCompressedChunks(size_t max_pending)
+{
+    while (!pending_chunks_.empty())
+    {
+        auto& chunk = pending_chunks_.front();
+        const bool ready = chunk->compressed.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        if (!ready && pending_chunks_.size() <= max_pending)
+        {
+            return;
+        }
+        chunk->compressed.get();
+        WriteChunk(*chunk);
+
+        chunk->records->clear();
+        chunk->message_indices.clear();
+        chunk->written_schemas.clear();
+        chunk->written_channels.clear();
+        free_chunks_.push_back(std::move(chunk));
+        pending_chunks_.pop_front();
+    }
+}
+
+void ParallelMcapWriter::WriteChunk(Chunk& chunk)
+{
+    const auto& records = *chunk.records;
+
+    mcap::Chunk chunk_record;
+    chunk_record.messageStartTime = chunk.message_start_time;
+    chunk_record.messageEndTime = chunk.message_end_time;
+    chunk_record.uncompressedSize = chunk.uncompressed_size;
+    chunk_record.uncompressedCrc = 0;
+    chunk_record.compression = CompressionName(options_.compression);
+    chunk_record.compressedSize = records.compressedSize();
+    chunk_record.records = records.compressedData();
+
+    mcap::ChunkIndex chunk_index;
+    chunk_index.messageStartTime = chunk.message_start_time;
+    chunk_index.messageEndTime = chunk.message_end_time;
+    chunk_index.chunkStartOffset = output_->size();
+    chunk_index.chunkLength = mcap::McapWriter::write(*output_, chunk_record);
+    chunk_index.compression = chunk_record.compression;
+    chunk_index.compressedSize = chunk_record.compressedSize;
+    chunk_index.uncompressedSize = chunk_record.uncompressedSize;
+
+    const auto message_index_start = output_->size();
+    for (const auto& [channel_id, message_index] : chunk.message_indices)
+    {
+        chunk_index.messageIndexOffsets.emplace(channel_id, output_->size());
+        mcap::McapWriter::write(*output_, message_index);
+    }
+    chunk_index.messageIndexLength = output_->size() - message_index_start;
+
+    chunk_indices_.push_back(std::move(chunk_index));
+    statistics_.chunkCount++;
+}
+
+void ParallelMcapWriter::WriteSummary(mcap::IWritable& output)
+{
+    mcap::McapWriter::write(output, mcap::DataEnd{});
+
+    const auto summary_start = output.size();
+    std::vector<mcap::SummaryOffset> summary_offsets;
+    const auto write_group = [&output, &summary_offsets](mcap::OpCode op_code, const auto& records) {
+        if (records.empty())
+        {
+            return;
+        }
+        const auto group_start = output.size();
+        for (const auto& record : records)
+        {
+            mcap::McapWriter::write(output, record);
+        }
+        summary_offsets.push_back(mcap::SummaryOffset{op_code, group_start, output.size() - group_start});
+    };
+    write_group(mcap::OpCode::Schema, schemas_);
+    write_group(mcap::OpCode::Channel, channels_);
+    write_group(mcap::OpCode::Statistics, std::vector<mcap::Statistics>{statistics_});
+    write_group(mcap::OpCode::ChunkIndex, chunk_indices_);
+    write_group(mcap::OpCode::MetadataIndex, metadata_indices_);
+
+    const auto summary_offset_start = output.size();
+    for (const auto& summary_offset : summary_offsets)
+    {
+        mcap::McapWriter::write(output, summary_offset);
+    }
+
+    mcap::McapWriter::write(output, mcap::Footer{summary_start, summary_offset_start}, false);
+    mcap::McapWriter::writeMagic(output);
+}
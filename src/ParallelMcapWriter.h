@@ -0,0 +1,87 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <mcap/mcap.hpp>
+
+#include "WorkerPool.h"
+
+/**
+ * MCAP writer that compresses finished chunks on a worker pool while the next chunk is filled.
+ *
+ * It offers the subset of the mcap::McapWriter interface used by RawMCAPTraceFileWriter and writes
+ * the same file layout: chunked data section with message indices, followed by a summary section
+ * with schemas, channels, statistics, chunk indices and metadata indices. Compressed chunks are
+ * written to the file in the order they were filled, so chunk and message indices stay valid.
+ * Every chunk contains the schema and channel records of its messages.
+ */
+class ParallelMcapWriter
+{
+  public:
+    ~ParallelMcapWriter();
+
+    mcap::Status Open(std::string_view file_name, const mcap::McapWriterOptions& options, size_t num_threads);
+    /** Write to an already opened output, which has to outlive the writer. Fails without compression threads */
+    mcap::Status Open(mcap::IWritable& output, const mcap::McapWriterOptions& options, size_t num_threads);
+    void AddSchema(mcap::Schema& schema);
+    void AddChannel(mcap::Channel& channel);
+    mcap::Status Write(const mcap::Message& message);
+    mcap::Status Write(const mcap::Metadata& metadata);
+    void Close();
+
+    /**
+     * Write all chunks filled so far and build the end of the file as if it was closed now, without writing it.
+     * The file is complete if it is cut at the returned offset and tail is appended.
+     *
+     * \param tail DataEnd record, summary section, footer and magic
+     * \return size of the data section at the checkpoint
+     */
+    uint64_t Checkpoint(std::string& tail);
+
+  private:
+    struct Chunk
+    {
+        std::unique_ptr<mcap::IChunkWriter> records;
+        mcap::Timestamp message_start_time = 0;
+        mcap::Timestamp message_end_time = 0;
+        uint64_t uncompressed_size = 0;  // the compressing chunk writers clear their uncompressed records in end()
+        std::map<mcap::ChannelId, mcap::MessageIndex> message_indices;
+        std::set<mcap::SchemaId> written_schemas;
+        std::set<mcap::ChannelId> written_channels;
+        std::future<void> compressed;
+    };
+
+    std::unique_ptr<Chunk> AcquireChunk();
+    void SubmitCurrentChunk();
+    void WriteCompressedChunks(size_t max_pending);
+    void WriteChunk(Chunk& chunk);
+    void WriteSummary(mcap::IWritable& output);
+
+    mcap::McapWriterOptions options_{""};
+    mcap::FileWriter file_writer_;
+    mcap::IWritable* output_ = nullptr;  // file_writer_ or an external output
+    bool file_open_ = false;
+    std::unique_ptr<WorkerPool> compression_pool_;
+
+    std::unique_ptr<Chunk> current_chunk_;
+    std::deque<std::unique_ptr<Chunk>> pending_chunks_;  // submitted for compression, in file order
+    std::vector<std::unique_ptr<Chunk>> free_chunks_;
+
+    std::vector<mcap::Schema> schemas_;    // index is id - 1
+    std::vector<mcap::Channel> channels_;  // index is id - 1
+    std::vector<mcap::ChunkIndex> chunk_indices_;
+    std::vector<mcap::MetadataIndex> metadata_indices_;
+    mcap::Statistics statistics_;
+};
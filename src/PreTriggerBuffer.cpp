@@ -0,0 +1,53 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "PreTriggerBuffer.h"
+
+PreTriggerBuffer::PreTriggerBuffer(double duration, uint64_t max_bytes, FrameBufferPool& buffer_pool)
+    : duration_(duration), max_bytes_(max_bytes), buffer_pool_(buffer_pool)
+{
+}
+
+PreTriggerBuffer::~PreTriggerBuffer()
+{
+    while (auto frame = Pop())
+    {
+        buffer_pool_.Release(std::move(frame));
+    }
+}
+
+void PreTriggerBuffer::Push(std::unique_ptr<FrameBuffer> frame)
+{
+    Evict(frame->sim_time, frame->size);
+    bytes_ += frame->size;
+    frames_.push_back(std::move(frame));
+}
+
+void PreTriggerBuffer::Trim(double sim_time)
+{
+    Evict(sim_time, 0);
+}
+
+std::unique_ptr<FrameBuffer> PreTriggerBuffer::Pop()
+{
+    if (frames_.empty())
+    {
+        return nullptr;
+    }
+    auto frame = std::move(frames_.front());
+    frames_.pop_front();
+    bytes_ -= frame->size;
+    return frame;
+}
+
+void PreTriggerBuffer::Evict(double sim_time, size_t incoming_bytes)
+{
+    while (!frames_.empty() && ((sim_time - frames_.front()->sim_time > duration_) || (max_bytes_ > 0 && bytes_ + incoming_bytes > max_bytes_)))
+    {
+        bytes_ -= frames_.front()->size;
+        buffer_pool_.Release(std::move(frames_.front()));
+        frames_.pop_front();
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "FrameBufferPool.h"
+
+/**
+ * In-memory history of the most recent frames before a trigger. Frames older than the configured
+ * simulated duration, or beyond the configured size, are given back to the buffer pool.
+ * Only used by the simulation thread, so it is not synchronized.
+ */
+class PreTriggerBuffer
+{
+  public:
+    /**
+     * \param duration simulated seconds of history to keep before the current frame
+     * \param max_bytes serialized frame bytes to keep, 0 for no size limit
+     * \param buffer_pool pool the frames are taken from
+     */
+    PreTriggerBuffer(double duration, uint64_t max_bytes, FrameBufferPool& buffer_pool);
+    ~PreTriggerBuffer();
+    PreTriggerBuffer(const PreTriggerBuffer&) = delete;
+    PreTriggerBuffer& operator=(const PreTriggerBuffer&) = delete;
+
+    /** Add the newest frame and evict the frames that fall out of the history */
+    void Push(std::unique_ptr<FrameBuffer> frame);
+
+    /** Evict the frames that are older than the history at sim_time */
+    void Trim(double sim_time);
+
+    /** Take the oldest frame, nullptr if the buffer is empty */
+    std::unique_ptr<FrameBuffer> Pop();
+
+  private:
+    void Evict(double sim_time, size_t incoming_bytes);
+
+    const double duration_;
+    const uint64_t max_bytes_;
+    FrameBufferPool& buffer_pool_;
+    std::deque<std::unique_ptr<FrameBuffer>> frames_;
+    uint64_t bytes_ = 0;
+};
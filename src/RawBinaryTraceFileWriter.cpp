@@ -0,0 +1,157 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "RawBinaryTraceFileWriter.h"
+
+#include <cstdint>
+
+#include "FrameIndex.h"
+#include "OsiWireFormat.h"
+
+bool RawBinaryTraceFileWriter::Open(const std::filesystem::path& file_path)
+{
+    return Open(file_path, StreamCompression::kNone);
+}
+
+bool RawBinaryTraceFileWriter::Open(const std::filesystem::path& file_path, StreamCompression compression)
+{
+    trace_file_.open(file_path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (compression != StreamCompression::kNone)
+    {
+        compressor_ = std::make_unique<StreamCompressor>(compression, trace_file_);
+    }
+    return trace_file_.is_open();
+}
+
+bool RawBinaryTraceFileWriter::OpenMapped(const std::filesystem::path& file_path, size_t extent_size)
+{
+    mapped_file_ = std::make_unique<MappedFile>();
+    if (!mapped_file_->Open(file_path, extent_size))
+    {
+        mapped_file_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool RawBinaryTraceFileWriter::OpenUring(const std::filesystem::path& file_path, bool direct_io)
+{
+    uring_file_ = std::make_unique<UringFile>();
+    if (!uring_file_->Open(file_path, direct_io))
+    {
+        uring_file_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool RawBinaryTraceFileWriter::OpenIndex(const std::filesystem::path& index_path)
+{
+    index_file_.open(index_path, std::ios::binary | std::ios::out | std::ios::trunc);
+    index_file_.write(kFrameIndexMagic, kFrameIndexMagicSize);
+    return index_file_.good();
+}
+
+void RawBinaryTraceFileWriter::Close()
+{
+    if (index_file_.is_open())
+    {
+        index_file_.close();
+    }
+    if (mapped_file_)
+    {
+        mapped_file_->Close();
+        mapped_file_.reset();
+    }
+    if (uring_file_)
+    {
+        uring_file_->Close();
+        uring_file_.reset();
+    }
+    if (compressor_)
+    {
+        compressor_->Finish();
+        compressor_.reset();
+    }
+    if (trace_file_.is_open())
+    {
+        trace_file_.close();
+    }
+}
+
+bool RawBinaryTraceFileWriter::Flush()
+{
+    if (index_file_.is_open())
+    {
+        index_file_.flush();
+    }
+    if (uring_file_)
+    {
+        return uring_file_->Flush();
+    }
+    if (compressor_ && !compressor_->Flush())
+    {
+        return false;
+    }
+    if (trace_file_.is_open())
+    {
+        trace_file_.flush();
+        return trace_file_.good();
+    }
+    // a memory mapping is written to the file by the kernel, even if the process does not exit normally
+    return true;
+}
+
+bool RawBinaryTraceFileWriter::WriteFrame(const void* data, int size)
+{
+    if ((!trace_file_.is_open() && !mapped_file_ && !uring_file_) || size < 0)
+    {
+        return false;
+    }
+
+    const auto message_size = static_cast<uint32_t>(size);
+    const char length_prefix[4] = {static_cast<char>(message_size & 0xFFU),
+                                   static_cast<char>((message_size >> 8U) & 0xFFU),
+                                   static_cast<char>((message_size >> 16U) & 0xFFU),
+                                   static_cast<char>((message_size >> 24U) & 0xFFU)};
+    if (index_file_.is_open() && !WriteIndexRecord(size, data))
+    {
+        return false;
+    }
+    stream_offset_ += sizeof(length_prefix) + static_cast<uint64_t>(size);
+    num_frames_++;
+    return Write(length_prefix, sizeof(length_prefix)) && Write(data, static_cast<size_t>(size));
+}
+
+bool RawBinaryTraceFileWriter::WriteIndexRecord(int size, const void* data)
+{
+    uint64_t timestamp_ns = 0;
+    if (!ReadTimestampNanoseconds(data, size, timestamp_ns))
+    {
+        return false;
+    }
+    char record[kFrameIndexRecordSize];
+    EncodeFrameIndexRecord(record, num_frames_, static_cast<uint32_t>(size), stream_offset_, timestamp_ns);
+    index_file_.write(record, sizeof(record));
+    return index_file_.good();
+}
+
+bool RawBinaryTraceFileWriter::Write(const void* data, size_t size)
+{
+    if (mapped_file_)
+    {
+        return mapped_file_->Write(data, size);
+    }
+    if (uring_file_)
+    {
+        return uring_file_->Write(data, size);
+    }
+    if (compressor_)
+    {
+        return compressor_->Write(data, size);
+    }
+    trace_file_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    return trace_file_.good();
+}
@@ -0,0 +1,76 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <memory>
+
+#include "MappedFile.h"
+#include "StreamCompressor.h"
+#include "UringFile.h"
+#include "osi-utilities/tracefile/Writer.h"
+
+/**
+ * Writer for the single channel binary .osi trace file format that takes already serialized
+ * OSI messages. Each frame is written as a 4 byte little-endian length prefix followed by the
+ * message bytes, without parsing and re-serializing the message.
+ * Optionally the whole frame stream is compressed on the fly (.osi.zst, .osi.lz4), or an
+ * uncompressed file is written through a memory mapping (see OpenMapped()) or io_uring (see OpenUring()).
+ *
+ * An optional sidecar index (see OpenIndex()) holds one fixed size record per frame:
+ * "OSIIDX01" magic, then per frame uint32 frame number, uint32 message size, uint64 byte offset
+ * of the length prefix in the uncompressed frame stream and uint64 OSI timestamp in nanoseconds,
+ * all little-endian. Record i starts at byte 8 + 24 * i (see FrameIndex.h).
+ */
+class RawBinaryTraceFileWriter final : public osi3::TraceFileWriter
+{
+  public:
+    bool Open(const std::filesystem::path& file_path) override;
+    bool Open(const std::filesystem::path& file_path, StreamCompression compression);
+    /** Open an uncompressed trace file that is preallocated and written through a memory mapping */
+    bool OpenMapped(const std::filesystem::path& file_path, size_t extent_size = MappedFile::kDefaultExtentSize);
+    /** Open an uncompressed trace file that is written asynchronously with io_uring, fails if io_uring is not available */
+    bool OpenUring(const std::filesystem::path& file_path, bool direct_io);
+    void Close() override;
+
+    /** Additionally write the sidecar frame index to index_path (see FrameIndexPath()), must be called before the first frame */
+    bool OpenIndex(const std::filesystem::path& index_path);
+
+    /**
+     * Write one serialized OSI message as a frame to the trace file.
+     *
+     * \param data serialized message
+     * \param size size of the serialized message in bytes
+     * \return true on success
+     */
+    bool WriteFrame(const void* data, int size);
+
+    /**
+     * Hand the frames written so far to the operating system, so they are kept if the process is killed.
+     * A compressed stream is flushed to complete blocks, which can be decompressed without the end of the frame.
+     */
+    bool Flush();
+
+    /** Bytes of the uncompressed frame stream written so far */
+    uint64_t StreamOffset() const { return stream_offset_; }
+
+    /** Bytes written to the trace file so far, the size of the compressed output for a compressed frame stream */
+    uint64_t FileOffset() const { return compressor_ ? compressor_->OutputSize() : stream_offset_; }
+
+  private:
+    bool Write(const void* data, size_t size);
+    bool WriteIndexRecord(int size, const void* data);
+
+    std::ofstream trace_file_;
+    std::unique_ptr<StreamCompressor> compressor_;
+    std::unique_ptr<MappedFile> mapped_file_;
+    std::unique_ptr<UringFile> uring_file_;
+    std::ofstream index_file_;
+    uint64_t stream_offset_ = 0;
+    uint32_t num_frames_ = 0;
+};
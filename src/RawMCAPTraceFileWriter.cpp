@@ -0,0 +1,236 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "RawMCAPTraceFileWriter.h"
+
+#include <queue>
+#include <unordered_set>
+
+#include <google/protobuf/descriptor.pb.h>
+
+#include "TraceFileWriter.h"
+
+namespace
+{
+// collect the file descriptor of the message and all its dependencies for the MCAP schema
+google::protobuf::FileDescriptorSet BuildFileDescriptorSet(const google::protobuf::Descriptor* top_level_descriptor)
+{
+    google::protobuf::FileDescriptorSet file_descriptor_set;
+    std::queue<const google::protobuf::FileDescriptor*> to_add;
+    to_add.push(top_level_descriptor->file());
+    std::unordered_set<std::string> seen_dependencies;
+    while (!to_add.empty())
+    {
+        const google::protobuf::FileDescriptor* next = to_add.front();
+        to_add.pop();
+        next->CopyTo(file_descriptor_set.add_file());
+        for (int i = 0; i < next->dependency_count(); ++i)
+        {
+            const auto* dependency = next->dependency(i);
+            if (seen_dependencies.insert(std::string(dependency->name())).second)
+            {
+                to_add.push(dependency);
+            }
+        }
+    }
+    return file_descriptor_set;
+}
+
+/** mcap output writing through io_uring */
+class UringWritable final : public mcap::IWritable
+{
+  public:
+    explicit UringWritable(UringFile& file) : file_(file) {}
+    void handleWrite(const std::byte* data, uint64_t size) override { file_.Write(data, static_cast<size_t>(size)); }
+    void end() override { file_.Close(); }
+    uint64_t size() const override { return file_.Size(); }
+
+  private:
+    UringFile& file_;
+};
+}  // namespace
+
+mcap::McapWriterOptions RawMCAPTraceFileWriter::WriterOptions(const TraceFileWriterOptions& options)
+{
+    mcap::McapWriterOptions mcap_options("");
+    switch (options.mcap_compression)
+    {
+        case McapCompression::kZstd:
+            mcap_options.compression = mcap::Compression::Zstd;
+            break;
+        case McapCompression::kLz4:
+            mcap_options.compression = mcap::Compression::Lz4;
+            break;
+        case McapCompression::kNone:
+            mcap_options.compression = mcap::Compression::None;
+            break;
+    }
+
+    // the MCAP writer only knows five compression levels, which correspond to the zstd levels -5, -3, 1, 5 and 19
+    const int level = options.mcap_compression_level;
+    if (level <= -4)
+    {
+        mcap_options.compressionLevel = mcap::CompressionLevel::Fastest;
+    }
+    else if (level <= -1)
+    {
+        mcap_options.compressionLevel = mcap::CompressionLevel::Fast;
+    }
+    else if (level <= 2)
+    {
+        mcap_options.compressionLevel = mcap::CompressionLevel::Default;
+    }
+    else if (level <= 9)
+    {
+        mcap_options.compressionLevel = mcap::CompressionLevel::Slow;
+    }
+    else
+    {
+        mcap_options.compressionLevel = mcap::CompressionLevel::Slowest;
+    }
+
+    if (options.mcap_chunk_size > 0)
+    {
+        mcap_options.chunkSize = options.mcap_chunk_size;
+    }
+    return mcap_options;
+}
+
+bool RawMCAPTraceFileWriter::Open(const std::filesystem::path& file_path)
+{
+    return Open(file_path, mcap::McapWriterOptions(""));
+}
+
+bool RawMCAPTraceFileWriter::Open(const std::filesystem::path& file_path, const mcap::McapWriterOptions& options, size_t compression_threads)
+{
+    if (compression_threads > 0)
+    {
+        parallel_writer_ = std::make_unique<ParallelMcapWriter>();
+        file_open_ = parallel_writer_->Open(file_path.string(), options, compression_threads).ok();
+    }
+    else
+    {
+        file_open_ = mcap_writer_.open(file_path.string(), options).ok();
+    }
+    return file_open_;
+}
+
+bool RawMCAPTraceFileWriter::OpenUring(const std::filesystem::path& file_path, const mcap::McapWriterOptions& options, size_t compression_threads, bool direct_io)
+{
+    uring_file_ = std::make_unique<UringFile>();
+    if (!uring_file_->Open(file_path, direct_io))
+    {
+        uring_file_.reset();
+        return false;
+    }
+    uring_output_ = std::make_unique<UringWritable>(*uring_file_);
+    if (compression_threads > 0)
+    {
+        parallel_writer_ = std::make_unique<ParallelMcapWriter>();
+        if (!parallel_writer_->Open(*uring_output_, options, compression_threads).ok())
+        {
+            // the caller falls back to Open(), which truncates the file again
+            parallel_writer_.reset();
+            uring_output_.reset();
+            uring_file_.reset();
+            return false;
+        }
+    }
+    else
+    {
+        mcap_writer_.open(*uring_output_, options);
+    }
+    file_open_ = true;
+    return file_open_;
+}
+
+bool RawMCAPTraceFileWriter::Checkpoint(std::string& tail, uint64_t& data_end)
+{
+    if (!file_open_ || !parallel_writer_)
+    {
+        return false;
+    }
+    data_end = parallel_writer_->Checkpoint(tail);
+    return !uring_file_ || uring_file_->Flush();
+}
+
+void RawMCAPTraceFileWriter::Close()
+{
+    if (!file_open_)
+    {
+        return;
+    }
+    if (parallel_writer_)
+    {
+        parallel_writer_->Close();
+    }
+    else
+    {
+        mcap_writer_.close();
+    }
+    file_open_ = false;
+}
+
+bool RawMCAPTraceFileWriter::AddFileMetadata(const mcap::Metadata& metadata)
+{
+    if (parallel_writer_)
+    {
+        return parallel_writer_->Write(metadata).ok();
+    }
+    return mcap_writer_.write(metadata).ok();
+}
+
+mcap::ChannelId RawMCAPTraceFileWriter::AddChannel(const std::string& topic,
+                                                   const google::protobuf::Descriptor* descriptor,
+                                                   const std::unordered_map<std::string, std::string>& channel_metadata)
+{
+    auto schema_id = schema_ids_.find(descriptor->full_name());
+    if (schema_id == schema_ids_.end())
+    {
+        mcap::Schema schema(descriptor->full_name(), "protobuf", BuildFileDescriptorSet(descriptor).SerializeAsString());
+        if (parallel_writer_)
+        {
+            parallel_writer_->AddSchema(schema);
+        }
+        else
+        {
+            mcap_writer_.addSchema(schema);
+        }
+        schema_id = schema_ids_.emplace(descriptor->full_name(), schema.id).first;
+    }
+
+    mcap::Channel channel(topic, "protobuf", schema_id->second, channel_metadata);
+    if (parallel_writer_)
+    {
+        parallel_writer_->AddChannel(channel);
+    }
+    else
+    {
+        mcap_writer_.addChannel(channel);
+    }
+    return channel.id;
+}
+
+bool RawMCAPTraceFileWriter::WriteFrame(mcap::ChannelId channel_id, const void* data, int size, uint64_t log_time, uint64_t publish_time)
+{
+    // the mcap writer does not report errors of its output
+    if (!file_open_ || size < 0 || (uring_file_ && uring_file_->Failed()))
+    {
+        return false;
+    }
+
+    mcap::Message message;
+    message.channelId = channel_id;
+    message.sequence = sequence_++;
+    message.logTime = log_time;
+    message.publishTime = publish_time;
+    message.data = static_cast<const std::byte*>(data);
+    message.dataSize = static_cast<uint64_t>(size);
+    if (parallel_writer_)
+    {
+        return parallel_writer_->Write(message).ok();
+    }
+    return mcap_writer_.write(message).ok();
+}
@@ -0,0 +1,89 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <google/protobuf/descriptor.h>
+#include <mcap/mcap.hpp>
+
+#include "ParallelMcapWriter.h"
+#include "UringFile.h"
+#include "osi-utilities/tracefile/Writer.h"
+
+struct TraceFileWriterOptions;
+
+/**
+ * Writer for the .mcap trace file format that takes already serialized OSI messages.
+ * The serialized bytes are handed to the MCAP writer as they are, so no parse and
+ * re-serialization of the message is needed.
+ */
+class RawMCAPTraceFileWriter final : public osi3::TraceFileWriter
+{
+  public:
+    /** MCAP writer options of the mcap_* recording options */
+    static mcap::McapWriterOptions WriterOptions(const TraceFileWriterOptions& options);
+
+    bool Open(const std::filesystem::path& file_path) override;
+
+    /**
+     * Open the trace file.
+     *
+     * \param file_path path of the trace file
+     * \param options MCAP writer options (compression, chunk size, ...)
+     * \param compression_threads number of threads compressing chunks in parallel, 0 compresses on the writing thread
+     */
+    bool Open(const std::filesystem::path& file_path, const mcap::McapWriterOptions& options, size_t compression_threads = 0);
+    /** Like Open(), but the file is written asynchronously with io_uring, fails if io_uring is not available */
+    bool OpenUring(const std::filesystem::path& file_path, const mcap::McapWriterOptions& options, size_t compression_threads, bool direct_io);
+    void Close() override;
+
+    /**
+     * Write the messages so far to the file and build the summary section for a later recovery of the file.
+     * Only available if the file was opened with compression threads.
+     *
+     * \param tail DataEnd record, summary section and footer that complete the file cut at data_end
+     * \param data_end size of the data section at the checkpoint
+     */
+    bool Checkpoint(std::string& tail, uint64_t& data_end);
+
+    bool AddFileMetadata(const mcap::Metadata& metadata);
+
+    /**
+     * Add a protobuf channel to the trace file.
+     *
+     * \param topic name of the channel
+     * \param descriptor descriptor of the OSI top-level message written to the channel
+     * \param channel_metadata additional metadata of the channel
+     * \return id of the created channel
+     */
+    mcap::ChannelId AddChannel(const std::string& topic, const google::protobuf::Descriptor* descriptor, const std::unordered_map<std::string, std::string>& channel_metadata);
+
+    /**
+     * Write one serialized OSI message to a channel.
+     *
+     * \param channel_id channel created with AddChannel()
+     * \param data serialized message
+     * \param size size of the serialized message in bytes
+     * \param log_time log time of the message in nanoseconds
+     * \param publish_time publish time of the message in nanoseconds
+     * \return true on success
+     */
+    bool WriteFrame(mcap::ChannelId channel_id, const void* data, int size, uint64_t log_time, uint64_t publish_time);
+
+  private:
+    // declared before the writers, which still write to it when they are destroyed
+    std::unique_ptr<UringFile> uring_file_;
+    std::unique_ptr<mcap::IWritable> uring_output_;
+    mcap::McapWriter mcap_writer_;
+    std::unique_ptr<ParallelMcapWriter> parallel_writer_;  // used instead of mcap_writer_ with compression threads
+    std::unordered_map<std::string, mcap::SchemaId> schema_ids_;  // by message type, shared by channels of the same type
+    bool file_open_ = false;
+    uint32_t sequence_ = 0;
+};
@@ -0,0 +1,106 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "RawTXTHTraceFileWriter.h"
+
+RawTXTHTraceFileWriter::~RawTXTHTraceFileWriter()
+{
+    Close();
+}
+
+bool RawTXTHTraceFileWriter::Open(const std::filesystem::path& file_path)
+{
+    return Open(file_path, 0);
+}
+
+bool RawTXTHTraceFileWriter::Open(const std::filesystem::path& file_path, size_t format_threads)
+{
+    trace_file_.open(file_path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (format_threads > 0)
+    {
+        format_pool_ = std::make_unique<WorkerPool>(format_threads);
+    }
+    return trace_file_.is_open();
+}
+
+void RawTXTHTraceFileWriter::Close()
+{
+    if (!trace_file_.is_open())
+    {
+        return;
+    }
+    WriteFormattedFrames(0);
+    format_pool_.reset();
+    trace_file_.close();
+}
+
+bool RawTXTHTraceFileWriter::WriteFrame(const void* data, int size, TextFrameFormatter format)
+{
+    if (!trace_file_.is_open() || data == nullptr || size < 0)
+    {
+        return false;
+    }
+    if (!format_pool_)
+    {
+        if (!format(data, size, text_))
+        {
+            return false;
+        }
+        trace_file_ << text_;
+        file_offset_ += text_.size();
+        return trace_file_.good();
+    }
+
+    // the input buffer is only valid during the call, the frame keeps a copy of the serialized message
+    std::unique_ptr<Frame> frame;
+    if (free_frames_.empty())
+    {
+        frame = std::make_unique<Frame>();
+    }
+    else
+    {
+        frame = std::move(free_frames_.back());
+        free_frames_.pop_back();
+    }
+    frame->serialized.assign(static_cast<const char*>(data), static_cast<size_t>(size));
+    Frame* formatted_frame = frame.get();
+    frame->done = format_pool_->Submit([formatted_frame, format]() {
+        formatted_frame->formatted = format(formatted_frame->serialized.data(), static_cast<int>(formatted_frame->serialized.size()), formatted_frame->text);
+    });
+    pending_frames_.push_back(std::move(frame));
+
+    // keep a bounded number of frames in flight, so memory use does not grow if formatting is slower than the simulation
+    return WriteFormattedFrames(2 * format_pool_->NumThreads());
+}
+
+bool RawTXTHTraceFileWriter::WriteFormattedFrames(size_t max_pending)
+{
+    bool success = true;
+    while (pending_frames_.size() > max_pending)
+    {
+        auto frame = std::move(pending_frames_.front());
+        pending_frames_.pop_front();
+        frame->done.get();
+        if (frame->formatted)
+        {
+            trace_file_ << frame->text;
+            file_offset_ += frame->text.size();
+        }
+        success = frame->formatted && success;
+        free_frames_.push_back(std::move(frame));
+    }
+    return success && trace_file_.good();
+}
+
+bool RawTXTHTraceFileWriter::Flush()
+{
+    if (!trace_file_.is_open())
+    {
+        return false;
+    }
+    const bool written = WriteFormattedFrames(0);
+    trace_file_.flush();
+    return written && trace_file_.good();
+}
@@ -0,0 +1,100 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/text_format.h>
+
+#include "WorkerPool.h"
+#include "osi-utilities/tracefile/Writer.h"
+
+/** Parses one serialized OSI message and prints it in protobuf text format, see FormatTextFrame() */
+using TextFrameFormatter = bool (*)(const void* data, int size, std::string& text);
+
+/**
+ * Text format of one serialized message of type T, as written by osi3::TXTHTraceFileWriter.
+ * Every thread reuses its own message object: ParseFromArray() clears it first, but keeps the memory
+ * of its sub-messages and repeated fields allocated.
+ */
+template <typename T>
+bool FormatTextFrame(const void* data, int size, std::string& text)
+{
+    thread_local T message;
+    if (!message.ParseFromArray(data, size))
+    {
+        return false;
+    }
+    text.clear();
+    return google::protobuf::TextFormat::PrintToString(message, &text);
+}
+
+/**
+ * Writer for the .txth trace file format that takes already serialized OSI messages.
+ *
+ * Text formatting is by far the most expensive part of writing a frame. With format threads, each
+ * frame is parsed and formatted independently on a worker pool, while the writing thread only copies
+ * the serialized message and appends the finished text of earlier frames to the file in the order
+ * they were written. Without format threads every frame is formatted on the writing thread.
+ */
+class RawTXTHTraceFileWriter final : public osi3::TraceFileWriter
+{
+  public:
+    ~RawTXTHTraceFileWriter() override;
+
+    bool Open(const std::filesystem::path& file_path) override;
+
+    /**
+     * Open the trace file.
+     *
+     * \param file_path path of the trace file
+     * \param format_threads number of threads formatting frames in parallel, 0 formats on the writing thread
+     */
+    bool Open(const std::filesystem::path& file_path, size_t format_threads);
+    void Close() override;
+
+    /**
+     * Write one serialized OSI message as text to the trace file.
+     * With format threads, a frame that cannot be parsed is reported by a later WriteFrame() or Flush() call.
+     *
+     * \param data serialized message
+     * \param size size of the serialized message in bytes
+     * \param format parses the message and prints it in text format, FormatTextFrame() of the message type
+     * \return true on success
+     */
+    bool WriteFrame(const void* data, int size, TextFrameFormatter format);
+
+    /** Write the text of all frames so far and hand it to the operating system, so it is kept if the process is killed */
+    bool Flush();
+
+    /** Bytes of text written to the trace file so far, frames still being formatted are not included */
+    uint64_t FileOffset() const { return file_offset_; }
+
+  private:
+    struct Frame
+    {
+        std::string serialized;
+        std::string text;
+        bool formatted = false;
+        std::future<void> done;
+    };
+
+    bool WriteFormattedFrames(size_t max_pending);
+
+    std::ofstream trace_file_;
+    std::unique_ptr<WorkerPool> format_pool_;
+    std::deque<std::unique_ptr<Frame>> pending_frames_;  // submitted for formatting, in file order
+    std::vector<std::unique_ptr<Frame>> free_frames_;
+    std::string text_;  // text of the current frame without format threads
+    uint64_t file_offset_ = 0;
+};
@@ -0,0 +1,344 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "ShmFrameRing.h"
+
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr char kRingMagic[8] = {'O', 'S', 'I', 'R', 'I', 'N', 'G', '1'};
+constexpr uint32_t kWrapMarker = 0xFFFFFFFFU;
+constexpr uint64_t kRecordHeaderSize = 16;
+
+uint64_t PadTo8(uint64_t size)
+{
+    return (size + 7U) & ~uint64_t{7U};
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free, "futex words must be plain 32 bit integers");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring counters must be lock-free to be shared between processes");
+}  // namespace
+
+struct ShmFrameRing::Header
+{
+    char magic[8];
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> head;  // bytes written by the producer
+    alignas(64) std::atomic<uint64_t> tail;  // bytes consumed by the consumer
+    std::atomic<uint32_t> space_available;   // futex word, incremented when space was freed for a waiting producer
+    std::atomic<uint32_t> producer_waiting;
+    std::atomic<uint32_t> producer_closed;
+    std::atomic<uint32_t> consumer_closed;
+};
+
+namespace
+{
+// the data area starts on its own cache line after the header
+constexpr size_t kDataOffset = 256;
+}  // namespace
+
+#ifdef __linux__
+
+ShmSegment::~ShmSegment()
+{
+    Unmap();
+    if (owner_)
+    {
+        Unlink(name_);
+    }
+}
+
+bool ShmSegment::Create(const std::string& name, size_t size)
+{
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    name_ = name;
+    owner_ = true;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    data_ = data;
+    size_ = size;
+    return true;
+}
+
+bool ShmSegment::Open(const std::string& name)
+{
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat file_status
+    {
+    };
+    if (fstat(fd, &file_status) != 0 || file_status.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    const auto size = static_cast<size_t>(file_status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    name_ = name;
+    data_ = data;
+    size_ = size;
+    return true;
+}
+
+void ShmSegment::Unlink(const std::string& name)
+{
+    shm_unlink(name.c_str());
+}
+
+void ShmSegment::Unmap()
+{
+    if (data_ != nullptr)
+    {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+}
+
+void ShmFutexWait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::milliseconds timeout)
+{
+    timespec relative_timeout{};
+    relative_timeout.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    relative_timeout.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+    // not FUTEX_PRIVATE_FLAG, the word is shared with other processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &relative_timeout, nullptr, 0);
+}
+
+void ShmFutexWake(std::atomic<uint32_t>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+bool ProcessAlive(int32_t pid)
+{
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+#else
+
+ShmSegment::~ShmSegment() = default;
+
+bool ShmSegment::Create(const std::string& /*name*/, size_t /*size*/)
+{
+    return false;
+}
+
+bool ShmSegment::Open(const std::string& /*name*/)
+{
+    return false;
+}
+
+void ShmSegment::Unlink(const std::string& /*name*/) {}
+
+void ShmSegment::Unmap() {}
+
+void ShmFutexWait(std::atomic<uint32_t>& /*word*/, uint32_t /*expected*/, std::chrono::milliseconds /*timeout*/) {}
+
+void ShmFutexWake(std::atomic<uint32_t>& /*word*/) {}
+
+bool ProcessAlive(int32_t /*pid*/)
+{
+    return false;
+}
+
+#endif
+
+bool ShmFrameRing::Create(const std::string& name, size_t capacity)
+{
+    static_assert(sizeof(Header) <= kDataOffset, "ring header overlaps the data area");
+    capacity_ = PadTo8(capacity);
+    if (!segment_.Create(name, kDataOffset + capacity_))
+    {
+        return false;
+    }
+    // the name is kept after the producer exits, the consumer removes it once it read all frames
+    segment_.Release();
+    name_ = name;
+    header_ = new (segment_.Data()) Header();
+    header_->capacity = capacity_;
+    std::memcpy(header_->magic, kRingMagic, sizeof(kRingMagic));
+    data_ = static_cast<char*>(segment_.Data()) + kDataOffset;
+    return true;
+}
+
+bool ShmFrameRing::Open(const std::string& name)
+{
+    if (!segment_.Open(name) || segment_.Size() < kDataOffset)
+    {
+        return false;
+    }
+    name_ = name;
+    header_ = static_cast<Header*>(segment_.Data());
+    capacity_ = header_->capacity;
+    if (std::memcmp(header_->magic, kRingMagic, sizeof(kRingMagic)) != 0 || segment_.Size() < kDataOffset + capacity_)
+    {
+        header_ = nullptr;
+        return false;
+    }
+    data_ = static_cast<char*>(segment_.Data()) + kDataOffset;
+    return true;
+}
+
+uint64_t ShmFrameRing::RecordSize(uint32_t size) const
+{
+    return kRecordHeaderSize + PadTo8(size);
+}
+
+bool ShmFrameRing::Fits(size_t size) const
+{
+    // a record may have to skip the end of the data area, which is shorter than the record
+    return header_ != nullptr && size < kWrapMarker && RecordSize(static_cast<uint32_t>(size)) <= capacity_ / 2;
+}
+
+bool ShmFrameRing::TryPush(const void* data, uint32_t size, uint32_t channel, double sim_time)
+{
+    if (!Fits(size))
+    {
+        return false;
+    }
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint64_t skip = 0;
+    if (!HasSpace(size, skip))
+    {
+        return false;
+    }
+    const uint64_t record_size = RecordSize(size);
+    uint64_t position = head % capacity_;
+    if (skip > 0)
+    {
+        std::memcpy(data_ + position, &kWrapMarker, sizeof(kWrapMarker));
+        position = 0;
+    }
+    char* record = data_ + position;
+    std::memcpy(record, &size, sizeof(size));
+    std::memcpy(record + 4, &channel, sizeof(channel));
+    std::memcpy(record + 8, &sim_time, sizeof(sim_time));
+    std::memcpy(record + kRecordHeaderSize, data, size);
+    // sequentially consistent, so a consumer that is going to sleep either sees the frame or is woken
+    header_->head.store(head + skip + record_size, std::memory_order_seq_cst);
+    return true;
+}
+
+bool ShmFrameRing::HasSpace(uint32_t size, uint64_t& skip) const
+{
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    const uint64_t tail = header_->tail.load(std::memory_order_seq_cst);
+    const uint64_t record_size = RecordSize(size);
+    const uint64_t position = head % capacity_;
+    skip = capacity_ - position < record_size ? capacity_ - position : 0;
+    return head + skip + record_size - tail <= capacity_;
+}
+
+void ShmFrameRing::WaitForSpace(uint32_t size, std::chrono::milliseconds timeout)
+{
+    header_->producer_waiting.store(1, std::memory_order_seq_cst);
+    const uint32_t space_available = header_->space_available.load(std::memory_order_seq_cst);
+    // the consumer does not wake the producer for space freed before producer_waiting was set
+    uint64_t skip = 0;
+    if (!HasSpace(size, skip))
+    {
+        ShmFutexWait(header_->space_available, space_available, timeout);
+    }
+    header_->producer_waiting.store(0, std::memory_order_relaxed);
+}
+
+void ShmFrameRing::CloseProducer()
+{
+    header_->producer_closed.store(1, std::memory_order_seq_cst);
+}
+
+void ShmFrameRing::CloseConsumer()
+{
+    header_->consumer_closed.store(1, std::memory_order_seq_cst);
+    header_->space_available.fetch_add(1, std::memory_order_seq_cst);
+    ShmFutexWake(header_->space_available);
+}
+
+bool ShmFrameRing::ConsumerClosed() const
+{
+    return header_->consumer_closed.load(std::memory_order_relaxed) != 0;
+}
+
+bool ShmFrameRing::Front(Frame& frame)
+{
+    const uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    if (tail == header_->head.load(std::memory_order_seq_cst))
+    {
+        return false;
+    }
+    uint64_t position = tail % capacity_;
+    uint64_t skip = 0;
+    uint32_t size = 0;
+    std::memcpy(&size, data_ + position, sizeof(size));
+    if (size == kWrapMarker)
+    {
+        skip = capacity_ - position;
+        position = 0;
+        std::memcpy(&size, data_, sizeof(size));
+    }
+    const char* record = data_ + position;
+    frame.size = size;
+    std::memcpy(&frame.channel, record + 4, sizeof(frame.channel));
+    std::memcpy(&frame.sim_time, record + 8, sizeof(frame.sim_time));
+    frame.data = record + kRecordHeaderSize;
+    front_size_ = skip + RecordSize(size);
+    return true;
+}
+
+void ShmFrameRing::PopFront()
+{
+    header_->tail.store(header_->tail.load(std::memory_order_relaxed) + front_size_, std::memory_order_seq_cst);
+    front_size_ = 0;
+    if (header_->producer_waiting.load(std::memory_order_seq_cst) != 0)
+    {
+        header_->space_available.fetch_add(1, std::memory_order_seq_cst);
+        ShmFutexWake(header_->space_available);
+    }
+}
+
+bool ShmFrameRing::Empty() const
+{
+    return header_->tail.load(std::memory_order_relaxed) == header_->head.load(std::memory_order_seq_cst);
+}
+
+bool ShmFrameRing::ProducerClosed() const
+{
+    return header_->producer_closed.load(std::memory_order_seq_cst) != 0;
+}
@@ -0,0 +1,119 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * POSIX shared memory segment, mapped read-write. The creator unlinks the name again if it is destroyed
+ * before Release() was called. Only available on Linux, Create() and Open() fail on other systems.
+ */
+class ShmSegment
+{
+  public:
+    ShmSegment() = default;
+    ~ShmSegment();
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+
+    /** Create a new zero-filled segment, fails if the name exists. Names start with '/' */
+    bool Create(const std::string& name, size_t size);
+    /** Map an existing segment with its full size */
+    bool Open(const std::string& name);
+    /** Keep the name of a created segment when it is unmapped */
+    void Release() { owner_ = false; }
+    static void Unlink(const std::string& name);
+
+    void* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+  private:
+    void Unmap();
+
+    std::string name_;
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    bool owner_ = false;
+};
+
+/** Sleep until the 32 bit word in shared memory differs from expected, a wake up or the timeout, whichever is first */
+void ShmFutexWait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::milliseconds timeout);
+/** Wake all processes sleeping on the word */
+void ShmFutexWake(std::atomic<uint32_t>& word);
+/** True if the process exists */
+bool ProcessAlive(int32_t pid);
+
+/**
+ * Single producer, single consumer ring of frames in a shared memory segment, which hands the frames of one
+ * FMU instance to the trace sink process without a copy through the kernel.
+ *
+ * The segment starts with a header with the byte counters head (written by the producer) and tail (written by
+ * the consumer), followed by the data area. Each frame is a record header (uint32 size, uint32 channel,
+ * double simulation time) followed by the message, padded to 8 bytes. A record that does not fit before the end
+ * of the data area starts at its beginning, the rest of the data area is skipped with a wrap marker.
+ * A producer waiting for space sleeps on a futex word of the header, which the consumer wakes when it frees space.
+ * The consumer side is woken by the owner of the ring, see TraceSinkClient.
+ */
+class ShmFrameRing
+{
+  public:
+    static constexpr size_t kDefaultCapacity = 32 * 1024 * 1024;
+
+    struct Frame
+    {
+        const void* data = nullptr;
+        uint32_t size = 0;
+        uint32_t channel = 0;
+        double sim_time = 0.0;
+    };
+
+    ShmFrameRing() = default;
+    ShmFrameRing(const ShmFrameRing&) = delete;
+    ShmFrameRing& operator=(const ShmFrameRing&) = delete;
+
+    /** Create the ring as producer, capacity is the size of the data area in bytes. The name is kept until Unlink() */
+    bool Create(const std::string& name, size_t capacity = kDefaultCapacity);
+    /** Open the ring of a producer as consumer */
+    bool Open(const std::string& name);
+    /** Remove the name of the ring, the memory is freed once both sides unmapped it */
+    void Unlink() { ShmSegment::Unlink(name_); }
+
+    /** True if a frame of this size can ever be pushed */
+    bool Fits(size_t size) const;
+    /** Append a frame if there is space for it, does not block */
+    bool TryPush(const void* data, uint32_t size, uint32_t channel, double sim_time);
+    /** Sleep until the consumer freed space for a frame of this size or the timeout */
+    void WaitForSpace(uint32_t size, std::chrono::milliseconds timeout);
+    /** Mark the end of the frames, the consumer finishes the ring when it is empty */
+    void CloseProducer();
+    /** True if the consumer does not read the ring anymore */
+    bool ConsumerClosed() const;
+
+    /** Oldest frame, valid until PopFront(). False if the ring is empty */
+    bool Front(Frame& frame);
+    void PopFront();
+    bool Empty() const;
+    bool ProducerClosed() const;
+    /** Stop reading the ring, a producer waiting for space gives up */
+    void CloseConsumer();
+
+  private:
+    struct Header;
+
+    uint64_t RecordSize(uint32_t size) const;
+    bool HasSpace(uint32_t size, uint64_t& skip) const;
+
+    std::string name_;
+    ShmSegment segment_;
+    Header* header_ = nullptr;
+    char* data_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t front_size_ = 0;  // bytes of the frame returned by Front(), including a skipped wrap
+};
@@ -0,0 +1,152 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "StreamCompressor.h"
+
+#include <algorithm>
+
+#include <lz4frame.h>
+#include <zstd.h>
+
+StreamCompressor::StreamCompressor(StreamCompression compression, std::ostream& output) : compression_(compression), output_(output)
+{
+    if (compression_ == StreamCompression::kZstd)
+    {
+        zstd_context_ = ZSTD_createCCtx();
+        output_buffer_.resize(ZSTD_CStreamOutSize());
+    }
+    else if (compression_ == StreamCompression::kLz4)
+    {
+        if (LZ4F_isError(LZ4F_createCompressionContext(&lz4_context_, LZ4F_VERSION)) != 0U)
+        {
+            lz4_context_ = nullptr;
+            return;
+        }
+        output_buffer_.resize(std::max<size_t>(LZ4F_compressBound(kLz4BlockSize, nullptr), LZ4F_HEADER_SIZE_MAX));
+        const size_t header_size = LZ4F_compressBegin(lz4_context_, output_buffer_.data(), output_buffer_.size(), nullptr);
+        if (LZ4F_isError(header_size) != 0U || !WriteOutput(header_size))
+        {
+            LZ4F_freeCompressionContext(lz4_context_);
+            lz4_context_ = nullptr;
+        }
+    }
+}
+
+StreamCompressor::~StreamCompressor()
+{
+    if (zstd_context_ != nullptr)
+    {
+        ZSTD_freeCCtx(zstd_context_);
+    }
+    if (lz4_context_ != nullptr)
+    {
+        LZ4F_freeCompressionContext(lz4_context_);
+    }
+}
+
+bool StreamCompressor::Write(const void* data, size_t size)
+{
+    if (finished_)
+    {
+        return false;
+    }
+    if (zstd_context_ != nullptr)
+    {
+        ZSTD_inBuffer input = {data, size, 0};
+        while (input.pos < input.size)
+        {
+            ZSTD_outBuffer output = {output_buffer_.data(), output_buffer_.size(), 0};
+            if (ZSTD_isError(ZSTD_compressStream2(zstd_context_, &output, &input, ZSTD_e_continue)) != 0U || !WriteOutput(output.pos))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (lz4_context_ != nullptr)
+    {
+        // feed lz4 in blocks, so the output buffer size is bounded
+        const auto* input = static_cast<const char*>(data);
+        while (size > 0)
+        {
+            const size_t block_size = std::min(size, kLz4BlockSize);
+            const size_t compressed_size = LZ4F_compressUpdate(lz4_context_, output_buffer_.data(), output_buffer_.size(), input, block_size, nullptr);
+            if (LZ4F_isError(compressed_size) != 0U || !WriteOutput(compressed_size))
+            {
+                return false;
+            }
+            input += block_size;
+            size -= block_size;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool StreamCompressor::Flush()
+{
+    if (finished_)
+    {
+        return false;
+    }
+    if (zstd_context_ != nullptr)
+    {
+        ZSTD_inBuffer input = {nullptr, 0, 0};
+        size_t remaining = 0;
+        do
+        {
+            ZSTD_outBuffer output = {output_buffer_.data(), output_buffer_.size(), 0};
+            remaining = ZSTD_compressStream2(zstd_context_, &output, &input, ZSTD_e_flush);
+            if (ZSTD_isError(remaining) != 0U || !WriteOutput(output.pos))
+            {
+                return false;
+            }
+        } while (remaining > 0);
+        return true;
+    }
+    if (lz4_context_ != nullptr)
+    {
+        const size_t compressed_size = LZ4F_flush(lz4_context_, output_buffer_.data(), output_buffer_.size(), nullptr);
+        return LZ4F_isError(compressed_size) == 0U && WriteOutput(compressed_size);
+    }
+    return false;
+}
+
+bool StreamCompressor::Finish()
+{
+    if (finished_)
+    {
+        return true;
+    }
+    finished_ = true;
+    if (zstd_context_ != nullptr)
+    {
+        ZSTD_inBuffer input = {nullptr, 0, 0};
+        size_t remaining = 0;
+        do
+        {
+            ZSTD_outBuffer output = {output_buffer_.data(), output_buffer_.size(), 0};
+            remaining = ZSTD_compressStream2(zstd_context_, &output, &input, ZSTD_e_end);
+            if (ZSTD_isError(remaining) != 0U || !WriteOutput(output.pos))
+            {
+                return false;
+            }
+        } while (remaining > 0);
+        return true;
+    }
+    if (lz4_context_ != nullptr)
+    {
+        const size_t compressed_size = LZ4F_compressEnd(lz4_context_, output_buffer_.data(), output_buffer_.size(), nullptr);
+        return LZ4F_isError(compressed_size) == 0U && WriteOutput(compressed_size);
+    }
+    return false;
+}
+
+bool StreamCompressor::WriteOutput(size_t size)
+{
+    output_.write(output_buffer_.data(), static_cast<std::streamsize>(size));
+    output_size_ += size;
+    return output_.good();
+}
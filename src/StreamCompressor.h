@@ -0,0 +1,58 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct ZSTD_CCtx_s;
+struct LZ4F_cctx_s;
+
+enum class StreamCompression : u_int8_t
+{
+    kNone = 0, /**< uncompressed */
+    kZstd,     /**< zstd frame (.zst) */
+    kLz4,      /**< lz4 frame (.lz4) */
+};
+
+/**
+ * Compresses a byte stream on the fly into a single zstd or lz4 frame, which can be
+ * decompressed with the standard command line tools (zstd -d, lz4 -d).
+ */
+class StreamCompressor
+{
+  public:
+    StreamCompressor(StreamCompression compression, std::ostream& output);
+    ~StreamCompressor();
+    StreamCompressor(const StreamCompressor&) = delete;
+    StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+    /** Compress the data and write the compressed output that is ready to the stream */
+    bool Write(const void* data, size_t size);
+
+    /** Write all data so far as complete blocks, which can be decompressed without the end of the frame */
+    bool Flush();
+
+    /** Flush the remaining data and write the end of the frame */
+    bool Finish();
+
+    /** Bytes of compressed output written to the stream so far */
+    uint64_t OutputSize() const { return output_size_; }
+
+  private:
+    static constexpr size_t kLz4BlockSize = 64 * 1024;
+
+    bool WriteOutput(size_t size);
+
+    const StreamCompression compression_;
+    std::ostream& output_;
+    std::vector<char> output_buffer_;
+    ZSTD_CCtx_s* zstd_context_ = nullptr;
+    LZ4F_cctx_s* lz4_context_ = nullptr;
+    uint64_t output_size_ = 0;
+    bool finished_ = false;
+};
@@ -0,0 +1,112 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "TraceCheckpoint.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace
+{
+constexpr char kCheckpointMagic[] = "OSICKP01";
+}  // namespace
+
+std::filesystem::path TraceCheckpoint::Path(const std::filesystem::path& trace_path)
+{
+    auto checkpoint_path = trace_path;
+    checkpoint_path += ".checkpoint";
+    return checkpoint_path;
+}
+
+bool TraceCheckpoint::Write(const std::filesystem::path& checkpoint_path) const
+{
+    // written completely under a temporary name first, the rename replaces the previous checkpoint atomically
+    auto temp_path = checkpoint_path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::out | std::ios::trunc);
+        file << kCheckpointMagic << '\n'
+             << "final_name_prefix=" << final_name_prefix << '\n'
+             << "final_name_suffix=" << final_name_suffix << '\n'
+             << "num_frames=" << num_frames << '\n'
+             << "has_index=" << (has_index ? 1 : 0) << '\n'
+             << "osi_data_end=" << osi_data_end << '\n'
+             << "file_data_end=" << file_data_end << '\n'
+             << "mcap_data_end=" << mcap_data_end << '\n'
+             << "mcap_summary=" << mcap_summary.size() << '\n';
+        file.write(mcap_summary.data(), static_cast<std::streamsize>(mcap_summary.size()));
+        file.close();
+        if (!file)
+        {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, checkpoint_path, error);
+    return !error;
+}
+
+bool TraceCheckpoint::Read(const std::filesystem::path& checkpoint_path)
+{
+    std::ifstream file(checkpoint_path, std::ios::binary);
+    std::string line;
+    if (!std::getline(file, line) || line != kCheckpointMagic)
+    {
+        return false;
+    }
+    while (std::getline(file, line))
+    {
+        const auto separator = line.find('=');
+        if (separator == std::string::npos)
+        {
+            return false;
+        }
+        const std::string key = line.substr(0, separator);
+        const std::string value = line.substr(separator + 1);
+        try
+        {
+            if (key == "final_name_prefix")
+            {
+                final_name_prefix = value;
+            }
+            else if (key == "final_name_suffix")
+            {
+                final_name_suffix = value;
+            }
+            else if (key == "num_frames")
+            {
+                num_frames = std::stoull(value);
+            }
+            else if (key == "has_index")
+            {
+                has_index = value == "1";
+            }
+            else if (key == "osi_data_end")
+            {
+                osi_data_end = std::stoull(value);
+            }
+            else if (key == "file_data_end")
+            {
+                file_data_end = std::stoull(value);
+            }
+            else if (key == "mcap_data_end")
+            {
+                mcap_data_end = std::stoull(value);
+            }
+            else if (key == "mcap_summary")
+            {
+                mcap_summary.resize(std::stoull(value));
+                file.read(mcap_summary.data(), static_cast<std::streamsize>(mcap_summary.size()));
+                return static_cast<size_t>(file.gcount()) == mcap_summary.size();
+            }
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,44 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/**
+ * State of a trace file that is still being written, stored next to its temporary file
+ * (trace file name + .checkpoint), so that the file can be finalized after a crash of the simulation.
+ *
+ * The sidecar starts with the "OSICKP01" magic line, followed by key=value lines. The summary of an
+ * MCAP file is stored last as its length in bytes and the raw bytes after the line break.
+ * It is replaced atomically, a reader sees either the previous or the new checkpoint.
+ */
+struct TraceCheckpoint
+{
+    /** start time, message type, OSI and protobuf version of the final file name, followed by the frame count */
+    std::string final_name_prefix;
+    /** custom name, segment number and extension of the final file name */
+    std::string final_name_suffix;
+    uint64_t num_frames = 0;
+    bool has_index = false;
+    /** bytes of complete frames in the uncompressed .osi frame stream */
+    uint64_t osi_data_end = 0;
+    /** size of a .txth or compressed .osi file, which holds exactly the frames of the checkpoint up to here */
+    uint64_t file_data_end = 0;
+    /** size of the MCAP data section, the file is complete if it is cut here and mcap_summary is appended */
+    uint64_t mcap_data_end = 0;
+    /** DataEnd record, summary section, footer and magic of an MCAP file, empty for other formats */
+    std::string mcap_summary;
+
+    /** Path of the checkpoint of a (temporary) trace file */
+    static std::filesystem::path Path(const std::filesystem::path& trace_path);
+
+    std::string FinalFileName(uint64_t frames) const { return final_name_prefix + std::to_string(frames) + final_name_suffix; }
+
+    bool Write(const std::filesystem::path& checkpoint_path) const;
+    bool Read(const std::filesystem::path& checkpoint_path);
+};
@@ -8,36 +8,434 @@
 #include "TraceFileWriter.h"
 
 #include "filesystem"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <fstream>
+#include <iostream>
 #include <utility>
 
+#include "FieldMaskFilter.h"
+#include "FrameHash.h"
+#include "FrameIndex.h"
+#include "FrameWriter.h"
+#include "GroundTruthSplitFrameWriter.h"
+#include "TraceCheckpoint.h"
+#include "TraceSinkClient.h"
 #include "osi-utilities/tracefile/writer/MCAPTraceFileWriter.h"
-#include "osi-utilities/tracefile/writer/SingleChannelBinaryTraceFileWriter.h"
-#include "osi-utilities/tracefile/writer/TXTHTraceFileWriter.h"
 #include "osi_sensordata.pb.h"
 #include "osi_sensorview.pb.h"
 
-void TraceFileWriter::Init(const std::string& trace_path, std::string protobuf_version, std::string custom_name, std::string message_type, FileFormat file_format, bool omit_timestamp)
+namespace
 {
+/**
+ * Parameter name of the first set option that a trace sink would not apply, because the sink writes the trace files
+ * with its own command line options. Empty if all of them have their default
+ */
+std::string SinkUnsupportedOption(const TraceFileWriterOptions& options)
+{
+    const TraceFileWriterOptions defaults;
+    const std::pair<bool, const char*> options_set[] = {
+        {options.trigger_mode, "trigger_mode"},
+        {options.segment_max_bytes != defaults.segment_max_bytes, "segment_max_size_mb"},
+        {options.segment_max_frames != defaults.segment_max_frames, "segment_max_frames"},
+        {options.segment_max_duration != defaults.segment_max_duration, "segment_max_duration"},
+        {!options.field_mask.empty(), "field_mask"},
+        {options.split_static_ground_truth, "split_static_ground_truth"},
+        {options.mcap_compression != defaults.mcap_compression, "mcap_compression"},
+        {options.mcap_compression_level != defaults.mcap_compression_level, "mcap_compression_level"},
+        {options.mcap_chunk_size != defaults.mcap_chunk_size, "mcap_chunk_size"},
+        {options.mcap_compression_threads != defaults.mcap_compression_threads, "mcap_compression_threads"},
+        {options.mcap_log_time != defaults.mcap_log_time, "mcap_log_time"},
+        {options.checkpoint_interval != defaults.checkpoint_interval, "checkpoint_interval"},
+        {options.mmap_output, "mmap_output"},
+        {options.io_uring_output, "io_uring_output"},
+        {options.direct_io, "direct_io"},
+        {options.osi_index, "osi_index"},
+        {options.txth_format_threads != defaults.txth_format_threads, "txth_format_threads"},
+    };
+    for (const auto& [set, name] : options_set)
+    {
+        if (set)
+        {
+            return name;
+        }
+    }
+    return {};
+}
+
+const google::protobuf::Descriptor* MessageDescriptor(const std::string& message_type)
+{
+    if (message_type == "sv")
+    {
+        return osi3::SensorView::descriptor();
+    }
+    if (message_type == "sd")
+    {
+        return osi3::SensorData::descriptor();
+    }
+    return osi3::GroundTruth::descriptor();
+}
+
+/** Write queue depth of io_uring output if write_queue_depth is 0 */
+constexpr size_t kUringQueueDepth = 16;
+}  // namespace
+
+TraceFileWriter::TraceFileWriter() = default;
+
+TraceFileWriter::~TraceFileWriter()
+{
+    StopWriterThread();
+}
+
+void TraceFileWriter::Init(const std::string& trace_path,
+                           std::string protobuf_version,
+                           std::string custom_name,
+                           std::string message_type,
+                           FileFormat file_format,
+                           bool omit_timestamp,
+                           const TraceFileWriterOptions& options)
+{
+    options_ = options;
     omit_timestamp_ = omit_timestamp;
     path_trace_folder_ = std::filesystem::path(trace_path);
     protobuf_version_ = std::move(protobuf_version);
     custom_name_ = std::move(custom_name);  // might be empty
     type_ = std::move(message_type);
     file_format_ = file_format;
+    channels_ = {{type_, options_.topic.empty() ? "sl-5-6-osi-trace-file-writer" : options_.topic}};
+    channels_.insert(channels_.end(), options_.additional_channels.begin(), options_.additional_channels.end());
+    if (channels_.size() > 1 && file_format_ != FileFormat::MCAP)
+    {
+        throw std::runtime_error("Multiple inputs can only be recorded into mcap trace files");
+    }
+    if (options_.deduplicate_frames)
+    {
+        last_frames_.resize(channels_.size());
+    }
+    if (!options_.sink_name.empty())
+    {
+        const std::string unsupported_option = SinkUnsupportedOption(options_);
+        if (!unsupported_option.empty())
+        {
+            std::cerr << "Trace sink " << options_.sink_name << " cannot apply " << unsupported_option << ", writing the trace file in this process" << std::endl;
+        }
+        else
+        {
+            sink_client_ = std::make_unique<TraceSinkClient>();
+            if (sink_client_->Connect(options_.sink_name, path_trace_folder_, protobuf_version_, custom_name_, file_format_, omit_timestamp_, channels_, options_.sink_ring_bytes))
+            {
+                return;
+            }
+            std::cerr << "Trace sink " << options_.sink_name << " not available, writing the trace file in this process" << std::endl;
+            sink_client_.reset();
+        }
+    }
+    if (options_.trigger_mode)
+    {
+        pre_trigger_buffer_ = std::make_unique<PreTriggerBuffer>(options_.pre_trigger_duration, options_.pre_trigger_max_bytes, frame_buffer_pool_);
+    }
+    if (options_.segment_max_bytes > 0 || options_.segment_max_frames > 0 || options_.segment_max_duration > 0.0 || options_.trigger_mode)
+    {
+        segment_finalizer_ = std::make_unique<WorkerPool>(1);
+    }
+    SetStartTime();
     SetFileName();
     SetupWriter();
     SetupDeserializedWriterFunction();
+
+    // io_uring writes are submitted and their completions reaped by the thread that writes the frames, which must not be Step()
+    if (options_.io_uring_output && options_.queue_depth == 0)
+    {
+        options_.queue_depth = kUringQueueDepth;
+    }
+    if (options_.queue_depth > 0)
+    {
+        // the queued frames, the frame written by the writer thread and the frame being pushed, dropped or rejected by Step().
+        // The pre-trigger buffer is limited by its duration and size instead
+        if (!pre_trigger_buffer_)
+        {
+            frame_buffer_pool_.SetMaxBuffers(options_.queue_depth + 2);
+        }
+        frame_queue_ = std::make_unique<FrameQueue>(options_.queue_depth, options_.queue_overflow_policy, frame_buffer_pool_);
+        writer_thread_ = std::thread(&TraceFileWriter::RunWriterThread, this);
+    }
 }
 
-bool TraceFileWriter::Step(const void* data, int size)
+bool TraceFileWriter::Step(const void* data, int size, double sim_time, size_t channel)
 {
+    const auto start = std::chrono::steady_clock::now();
+    const bool success = StepFrame(data, size, sim_time, channel);
+    last_step_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    total_step_seconds_ += last_step_seconds_;
+    max_step_seconds_ = std::max(max_step_seconds_, last_step_seconds_);
+    num_steps_++;
+    return success;
+}
+
+TraceFileWriterStatistics TraceFileWriter::Statistics() const
+{
+    TraceFileWriterStatistics statistics;
+    statistics.last_step_seconds = last_step_seconds_;
+    statistics.mean_step_seconds = num_steps_ > 0 ? total_step_seconds_ / static_cast<double>(num_steps_) : 0.0;
+    statistics.max_step_seconds = max_step_seconds_;
+    statistics.frames_written = frames_written_.load(std::memory_order_relaxed);
+    statistics.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    statistics.frames_deduplicated = frames_deduplicated_;
+    if (frame_queue_)
+    {
+        statistics.frames_dropped = frame_queue_->NumDropped();
+        statistics.queue_size = frame_queue_->Size();
+    }
+    return statistics;
+}
+
+bool TraceFileWriter::StepFrame(const void* data, int size, double sim_time, size_t channel)
+{
+    // frame_writers_ is rebuilt by the writer thread when a segment is rotated, channels_ is fixed since Init()
+    if (channel >= channels_.size())
+    {
+        return false;
+    }
+    if (options_.deduplicate_frames && RepeatsLastFrame(data, size, channel))
+    {
+        frames_deduplicated_++;
+        return true;
+    }
+    if (sink_client_)
+    {
+        if (!sink_client_->Push(data, size, channel, sim_time))
+        {
+            return false;
+        }
+        frames_written_.fetch_add(1, std::memory_order_relaxed);
+        bytes_written_.fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+        return true;
+    }
+    if (pre_trigger_buffer_ && !(trigger_active_ && sim_time <= post_trigger_end_))
+    {
+        trigger_active_ = false;
+        if (size < 0)
+        {
+            return false;
+        }
+        auto frame = frame_buffer_pool_.Acquire(data, static_cast<size_t>(size));
+        frame->sim_time = sim_time;
+        frame->channel = channel;
+        pre_trigger_buffer_->Push(std::move(frame));
+        return true;
+    }
+
+    const bool starts_segment = std::exchange(start_segment_pending_, false);
+    if (!frame_queue_)
+    {
+        return WriteFrame(data, size, sim_time, channel, starts_segment);
+    }
+    // report errors of the writer thread at the next step
+    if (write_failed_ || size < 0)
+    {
+        return false;
+    }
+    auto frame = frame_buffer_pool_.Acquire(data, static_cast<size_t>(size));
+    frame->sim_time = sim_time;
+    frame->starts_segment = starts_segment;
+    frame->channel = channel;
+    return frame_queue_->Push(std::move(frame));
+}
+
+bool TraceFileWriter::RepeatsLastFrame(const void* data, int size, size_t channel)
+{
+    if (size < 0)
+    {
+        return false;
+    }
+    // the input buffer of a paused or slower upstream model is unchanged, but may still be rewritten in place, so the content is hashed every step
+    const uint64_t hash = XxHash64(data, static_cast<size_t>(size));
+    LastFrame& last_frame = last_frames_[channel];
+    if (last_frame.valid && last_frame.size == size && last_frame.hash == hash)
+    {
+        return true;
+    }
+    last_frame = {true, size, hash};
+    return false;
+}
+
+bool TraceFileWriter::Trigger(double sim_time)
+{
+    if (!pre_trigger_buffer_)
+    {
+        return true;
+    }
+
+    bool success = true;
+    if (!trigger_active_ || sim_time > post_trigger_end_)
+    {
+        // new event: its history goes in front of the triggering frame into a new segment
+        trigger_active_ = true;
+        start_segment_pending_ = true;
+        pre_trigger_buffer_->Trim(sim_time);
+        while (auto frame = pre_trigger_buffer_->Pop())
+        {
+            frame->starts_segment = std::exchange(start_segment_pending_, false);
+            success = WriteBufferedFrame(std::move(frame)) && success;
+        }
+    }
+    post_trigger_end_ = sim_time + options_.post_trigger_duration;
+    return success;
+}
+
+bool TraceFileWriter::WriteBufferedFrame(std::unique_ptr<FrameBuffer> frame)
+{
+    if (frame_queue_)
+    {
+        return !write_failed_ && frame_queue_->Push(std::move(frame));
+    }
+    const bool success = WriteFrame(frame->data.get(), static_cast<int>(frame->size), frame->sim_time, frame->channel, frame->starts_segment);
+    frame_buffer_pool_.Release(std::move(frame));
+    return success;
+}
+
+bool TraceFileWriter::WriteFrame(const void* data, int size, double sim_time, size_t channel, bool starts_segment)
+{
+    if (segment_finalizer_)
+    {
+        if (((starts_segment && num_frames_ > 0) || SegmentLimitReached(size, sim_time)) && !RotateSegment())
+        {
+            return false;
+        }
+        if (num_frames_ == 0)
+        {
+            segment_start_time_ = sim_time;
+        }
+        segment_bytes_ += static_cast<uint64_t>(std::max(size, 0));
+    }
     num_frames_++;
-    return serialized_writer_function_(data, size);
+    const bool osi_version_unknown = osi_version_.empty();
+    if (!frame_writers_[channel]->Write(data, size, sim_time))
+    {
+        return false;
+    }
+    frames_written_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(static_cast<uint64_t>(std::max(size, 0)), std::memory_order_relaxed);
+
+    // the first checkpoint of a file is written with its first frame, another one once the main input set the OSI version in the file name
+    if (options_.checkpoint_interval > 0.0 && (num_frames_ == 1 || (osi_version_unknown && !osi_version_.empty()) || sim_time >= next_checkpoint_time_))
+    {
+        next_checkpoint_time_ = sim_time + options_.checkpoint_interval;
+        return WriteCheckpoint();
+    }
+    return true;
 }
 
-void TraceFileWriter::SetFileName()
+bool TraceFileWriter::WriteCheckpoint()
+{
+    TraceCheckpoint checkpoint;
+    checkpoint.final_name_prefix = FinalFileNamePrefix();
+    checkpoint.final_name_suffix = FileNameSuffix();
+    checkpoint.num_frames = static_cast<uint64_t>(num_frames_);
+    checkpoint.has_index = HasOsiIndex();
+    bool flushed = true;
+    if (file_format_ == FileFormat::MCAP)
+    {
+        flushed = static_cast<RawMCAPTraceFileWriter&>(*writer_).Checkpoint(checkpoint.mcap_summary, checkpoint.mcap_data_end);
+    }
+    else if (file_format_ == FileFormat::TXTH)
+    {
+        auto& txth_writer = static_cast<RawTXTHTraceFileWriter&>(*writer_);
+        flushed = txth_writer.Flush();
+        checkpoint.file_data_end = txth_writer.FileOffset();
+    }
+    else
+    {
+        auto& binary_writer = static_cast<RawBinaryTraceFileWriter&>(*writer_);
+        flushed = binary_writer.Flush();
+        checkpoint.osi_data_end = binary_writer.StreamOffset();
+        checkpoint.file_data_end = binary_writer.FileOffset();
+    }
+    return flushed && checkpoint.Write(TraceCheckpoint::Path(path_trace_temp_));
+}
+
+bool TraceFileWriter::SegmentLimitReached(int size, double sim_time) const
+{
+    if (num_frames_ == 0)
+    {
+        return false;
+    }
+    return (options_.segment_max_frames > 0 && static_cast<size_t>(num_frames_) >= options_.segment_max_frames) ||
+           (options_.segment_max_bytes > 0 && segment_bytes_ + static_cast<uint64_t>(std::max(size, 0)) > options_.segment_max_bytes) ||
+           (options_.segment_max_duration > 0.0 && sim_time - segment_start_time_ >= options_.segment_max_duration);
+}
+
+bool TraceFileWriter::RotateSegment()
+{
+    // the final name is fixed now, closing (e.g. the MCAP summary) and renaming the segment is left to the finalizer thread
+    std::shared_ptr<osi3::TraceFileWriter> finished_writer = std::move(writer_);
+    frame_writers_.clear();
+    segment_finalized_.push_back(segment_finalizer_->Submit([finished_writer, temp_path = path_trace_temp_, final_path = FinalTracePath(), has_index = HasOsiIndex()]() {
+        finished_writer->Close();
+        RenameTraceFile(temp_path, final_path, has_index);
+    }));
+
+    segment_index_++;
+    num_frames_ = 0;
+    segment_bytes_ = 0;
+    SetFileName();
+    SetupWriter();
+    SetupDeserializedWriterFunction();
+    return CheckFinalizedSegments(false);
+}
+
+bool TraceFileWriter::CheckFinalizedSegments(bool wait)
+{
+    bool success = true;
+    auto segment = segment_finalized_.begin();
+    while (segment != segment_finalized_.end())
+    {
+        if (!wait && segment->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++segment;
+            continue;
+        }
+        try
+        {
+            segment->get();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Could not finalize trace file segment: " << e.what() << std::endl;
+            success = false;
+        }
+        segment = segment_finalized_.erase(segment);
+    }
+    return success;
+}
+
+void TraceFileWriter::RunWriterThread()
+{
+    std::unique_ptr<FrameBuffer> frame;
+    while (frame_queue_->Pop(frame))
+    {
+        if (!WriteFrame(frame->data.get(), static_cast<int>(frame->size), frame->sim_time, frame->channel, frame->starts_segment))
+        {
+            write_failed_ = true;
+        }
+        frame_buffer_pool_.Release(std::move(frame));
+    }
+}
+
+void TraceFileWriter::StopWriterThread()
+{
+    if (!writer_thread_.joinable())
+    {
+        return;
+    }
+    // the writer thread drains the remaining frames before it returns
+    frame_queue_->Close();
+    writer_thread_.join();
+}
+
+void TraceFileWriter::SetStartTime()
 {
     time_t curr_time{};
     char buf[80];
@@ -49,135 +447,212 @@ void TraceFileWriter::SetFileName()
     } else {
         start_time_ = std::string(buf);
     }
+}
 
-    auto trace_file_name = start_time_ + "_" + type_;
-    if (!custom_name_.empty())
+void TraceFileWriter::SetFileName()
+{
+    path_trace_temp_ = path_trace_folder_ / (start_time_ + "_" + type_ + FileNameSuffix());
+}
+
+std::string TraceFileWriter::FileNameSuffix() const
+{
+    // segments share the start time and are numbered as part of the custom name
+    std::string custom_name = custom_name_;
+    if (segment_finalizer_)
     {
-        trace_file_name += "_" + custom_name_;
+        char segment_number[16];
+        snprintf(segment_number, sizeof(segment_number), "%04zu", segment_index_ + 1);
+        custom_name += (custom_name.empty() ? "" : "_") + std::string(segment_number);
     }
 
-    trace_file_name += kFileNameMessageTypeMap.at(file_format_);
+    std::string suffix;
+    if (!custom_name.empty())
+    {
+        suffix += "_" + custom_name;
+    }
+    return suffix + kFileNameMessageTypeMap.at(file_format_);
+}
 
-    path_trace_temp_ = path_trace_folder_ / trace_file_name;
+bool TraceFileWriter::HasOsiIndex() const
+{
+    return options_.osi_index && (file_format_ == FileFormat::OSI || file_format_ == FileFormat::OSI_ZST || file_format_ == FileFormat::OSI_LZ4);
 }
 
-void TraceFileWriter::SetupDeserializedWriterFunction()
+void TraceFileWriter::RenameTraceFile(const std::filesystem::path& temp_path, const std::filesystem::path& final_path, bool has_index)
 {
-    if (type_ == "sv")
+    std::filesystem::rename(temp_path, final_path);
+    if (has_index)
     {
-        setupForMessageType<osi3::SensorView>();
+        std::filesystem::rename(FrameIndexPath(temp_path), FrameIndexPath(final_path));
     }
-    else if (type_ == "sd")
+    // the file is complete, a checkpoint is not needed anymore
+    std::error_code error;
+    std::filesystem::remove(TraceCheckpoint::Path(temp_path), error);
+}
+
+void TraceFileWriter::RemoveTraceFile(const std::filesystem::path& temp_path, bool has_index)
+{
+    std::error_code error;
+    std::filesystem::remove(temp_path, error);
+    if (has_index)
     {
-        setupForMessageType<osi3::SensorData>();
+        std::filesystem::remove(FrameIndexPath(temp_path), error);
     }
-    else if (type_ == "gt")
+    std::filesystem::remove(TraceCheckpoint::Path(temp_path), error);
+}
+
+std::string TraceFileWriter::FinalFileNamePrefix() const
+{
+    return start_time_ + "_" + type_ + "_" + osi_version_ + "_" + protobuf_version_ + "_";
+}
+
+std::filesystem::path TraceFileWriter::FinalTracePath() const
+{
+    // rename file based on number of frames
+    return path_trace_folder_ / (FinalFileNamePrefix() + std::to_string(num_frames_) + FileNameSuffix());
+}
+
+void TraceFileWriter::SetupDeserializedWriterFunction()
+{
+    frame_writers_.clear();
+    for (const auto& channel : channels_)
     {
-        setupForMessageType<osi3::GroundTruth>();
+        // the file name carries the OSI version of the main input
+        std::string* osi_version = frame_writers_.empty() ? &osi_version_ : nullptr;
+        if (channel.message_type == "sv")
+        {
+            frame_writers_.push_back(setupForMessageType<osi3::SensorView>(channel.topic, osi_version));
+        }
+        else if (channel.message_type == "sd")
+        {
+            frame_writers_.push_back(setupForMessageType<osi3::SensorData>(channel.topic, osi_version));
+        }
+        else if (channel.message_type == "gt" && options_.split_static_ground_truth && file_format_ == FileFormat::MCAP)
+        {
+            frame_writers_.push_back(
+                std::make_unique<GroundTruthSplitFrameWriter>(static_cast<RawMCAPTraceFileWriter&>(*writer_), osi_version, channel.topic, options_.mcap_log_time));
+        }
+        else if (channel.message_type == "gt")
+        {
+            frame_writers_.push_back(setupForMessageType<osi3::GroundTruth>(channel.topic, osi_version));
+        }
+        else
+        {
+            throw std::runtime_error("Unknown message type: " + channel.message_type);
+        }
     }
-    else
+
+    if (!options_.field_mask.empty())
     {
-        throw std::runtime_error("Unknown message type: " + type_);
+        frame_writers_.front() = std::make_unique<FieldMaskFrameWriter>(std::move(frame_writers_.front()), MessageDescriptor(channels_.front().message_type), options_.field_mask);
     }
 }
 
 template <typename T>
-void TraceFileWriter::setupForMessageType()
+std::unique_ptr<IFrameWriter> TraceFileWriter::setupForMessageType(const std::string& topic, std::string* osi_version)
 {
-    if (file_format_ == FileFormat::MCAP)
+    // the write path is fixed for the whole recording, so Step() only needs a single virtual call
+    switch (file_format_)
     {
-        auto mcap_writer = dynamic_cast<osi3::MCAPTraceFileWriter*>(writer_.get());
-
-        writer_function_consecutive_ = [mcap_writer](const void* data, int size) {
-            T msg;
-            msg.ParseFromArray(data, size);
-            return mcap_writer->WriteMessage(msg, "sl-5-6-osi-trace-file-writer");
-        };
+        case FileFormat::MCAP:
+            return std::make_unique<FrameWriter<T, FileFormat::MCAP>>(static_cast<RawMCAPTraceFileWriter&>(*writer_), osi_version, topic, options_.mcap_log_time);
+        case FileFormat::TXTH:
+            return std::make_unique<FrameWriter<T, FileFormat::TXTH>>(static_cast<RawTXTHTraceFileWriter&>(*writer_), osi_version, topic);
+        case FileFormat::OSI:
+        case FileFormat::OSI_ZST:
+        case FileFormat::OSI_LZ4:
+            return std::make_unique<FrameWriter<T, FileFormat::OSI>>(static_cast<RawBinaryTraceFileWriter&>(*writer_), osi_version, topic);
+        default:
+            throw std::runtime_error("Unknown file format");
     }
-    else if (file_format_ == FileFormat::OSI)
-    {
-        auto binary_writer = dynamic_cast<osi3::SingleChannelBinaryTraceFileWriter*>(writer_.get());
-        writer_function_consecutive_ = [binary_writer](const void* data, int size) {
-            T msg;
-            msg.ParseFromArray(data, size);
-            return binary_writer->WriteMessage(msg);
-        };
-    }
-    else if (file_format_ == FileFormat::TXTH)
-    {
-        auto txth_writer = dynamic_cast<osi3::TXTHTraceFileWriter*>(writer_.get());
-        writer_function_consecutive_ = [txth_writer](const void* data, int size) {
-            T msg;
-            msg.ParseFromArray(data, size);
-            return txth_writer->WriteMessage(msg);
-        };
-    }
-
-    // for the first time we receive a message, we need to extract the OSI version to add
-    // it to the mcap channel metadata (and thus create the channel on the first message)
-    // and add the OSI version the trace file name in the termination step
-    serialized_writer_function_ = [this](const void* data, int size) {
-        T msg;
-        msg.ParseFromArray(data, size);
-        auto version = msg.version();
-        this->osi_version_ = std::to_string(version.version_major()) + std::to_string(version.version_minor()) + std::to_string(version.version_patch());
-        // create mcap channel if mcap reader
-        if (this->file_format_ == FileFormat::MCAP)
-        {
-            auto mcap_writer = dynamic_cast<osi3::MCAPTraceFileWriter*>(writer_.get());
-            std::unordered_map<std::string, std::string> channel_metadata = {
-                {"net.asam.osi.trace.channel.description", "Channel added via openMSL sl-5-6-osi-trace-file-writer"},
-                {"net.asam.osi.trace.channel.osi_version",  // in the current implementation of asam-osi-utilities this will be overwritten. This must be changed in the
-                                                            // asam-osi-utilities library
-                 std::to_string(version.version_major()) + "." + std::to_string(version.version_minor()) + "." + std::to_string(version.version_patch())}};
-            mcap_writer->AddChannel("sl-5-6-osi-trace-file-writer", T::descriptor(), channel_metadata);
-        }
-        // while this is the first call, we still need to write the data to the file
-        auto write_success = this->writer_function_consecutive_(data, size);
-        // replace the writer function for the next calls
-        this->serialized_writer_function_ = this->writer_function_consecutive_;
-        return write_success;
-    };
 }
 
 void TraceFileWriter::SetupWriter()
 {
     if (file_format_ == FileFormat::MCAP)
     {
-        auto writer = std::make_unique<osi3::MCAPTraceFileWriter>();
-        writer->Open(path_trace_temp_);
+        // checkpoints need the chunk indexes of the parallel writer, which is used with at least one compression thread
+        size_t compression_threads = options_.mcap_compression_threads;
+        if (options_.checkpoint_interval > 0.0)
+        {
+            compression_threads = std::max<size_t>(compression_threads, 1);
+        }
+        auto writer = std::make_unique<RawMCAPTraceFileWriter>();
+        if (!options_.io_uring_output || !writer->OpenUring(path_trace_temp_, RawMCAPTraceFileWriter::WriterOptions(options_), compression_threads, options_.direct_io))
+        {
+            if (options_.io_uring_output)
+            {
+                std::cerr << "io_uring output not available, falling back to stream writes" << std::endl;
+            }
+            writer->Open(path_trace_temp_, RawMCAPTraceFileWriter::WriterOptions(options_), compression_threads);
+        }
         writer->AddFileMetadata(osi3::MCAPTraceFileWriter::PrepareRequiredFileMetadata());
         writer_ = std::move(writer);
     }
     else if (file_format_ == FileFormat::OSI)
     {
-        auto writer = std::make_unique<osi3::SingleChannelBinaryTraceFileWriter>();
-        writer->Open(path_trace_temp_);
+        auto writer = std::make_unique<RawBinaryTraceFileWriter>();
+        const bool uring_opened = options_.io_uring_output && writer->OpenUring(path_trace_temp_, options_.direct_io);
+        if (options_.io_uring_output && !uring_opened)
+        {
+            std::cerr << "io_uring output not available, falling back to " << (options_.mmap_output ? "memory mapped output" : "stream writes") << std::endl;
+        }
+        if (!uring_opened && (!options_.mmap_output || !writer->OpenMapped(path_trace_temp_)))
+        {
+            if (options_.mmap_output)
+            {
+                std::cerr << "Memory mapped output not available, falling back to stream writes" << std::endl;
+            }
+            writer->Open(path_trace_temp_);
+        }
+        writer_ = std::move(writer);
+    }
+    else if (file_format_ == FileFormat::OSI_ZST)
+    {
+        auto writer = std::make_unique<RawBinaryTraceFileWriter>();
+        writer->Open(path_trace_temp_, StreamCompression::kZstd);
+        writer_ = std::move(writer);
+    }
+    else if (file_format_ == FileFormat::OSI_LZ4)
+    {
+        auto writer = std::make_unique<RawBinaryTraceFileWriter>();
+        writer->Open(path_trace_temp_, StreamCompression::kLz4);
         writer_ = std::move(writer);
     }
     else if (file_format_ == FileFormat::TXTH)
     {
-        auto writer = std::make_unique<osi3::TXTHTraceFileWriter>();
-        writer->Open(path_trace_temp_);
+        auto writer = std::make_unique<RawTXTHTraceFileWriter>();
+        writer->Open(path_trace_temp_, options_.txth_format_threads);
         writer_ = std::move(writer);
     }
     else
     {
         throw std::runtime_error("Unknown file format");
     }
+
+    if (HasOsiIndex())
+    {
+        static_cast<RawBinaryTraceFileWriter&>(*writer_).OpenIndex(FrameIndexPath(path_trace_temp_));
+    }
 }
 
-void TraceFileWriter::Term() const
+void TraceFileWriter::Term()
 {
+    if (sink_client_)
+    {
+        sink_client_->Close();
+        return;
+    }
+    StopWriterThread();
     writer_->Close();
-
-    // rename file based on number of frames
-    std::filesystem::path path_trace_final_ = path_trace_folder_ / (start_time_ + "_" + type_ + "_" + osi_version_ + "_" + protobuf_version_ + "_" + std::to_string(num_frames_));
-    if (!custom_name_.empty())
+    if (pre_trigger_buffer_ && num_frames_ == 0)
     {
-        path_trace_final_ += "_" + custom_name_;
+        // no trigger event in this run, the segment opened for the first one stays empty
+        RemoveTraceFile(path_trace_temp_, HasOsiIndex());
     }
-    path_trace_final_ += kFileNameMessageTypeMap.at(file_format_);
-
-    std::filesystem::rename(path_trace_temp_, path_trace_final_);
+    else
+    {
+        RenameTraceFile(path_trace_temp_, FinalTracePath(), HasOsiIndex());
+    }
+    CheckFinalizedSegments(true);
 }
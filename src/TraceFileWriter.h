@@ -7,9 +7,18 @@
 
 #pragma once
 
+#include <atomic>
 #include <filesystem>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "FrameBufferPool.h"
+#include "FrameQueue.h"
+#include "PreTriggerBuffer.h"
+#include "WorkerPool.h"
 #include "osi-utilities/tracefile/Writer.h"
 #include "osi_sensordata.pb.h"
 
@@ -19,21 +28,199 @@ enum class FileFormat : u_int8_t
     MCAP,         /**< .mcap trace file format */
     OSI,          /**< .osi trace file format*/
     TXTH,         /**< .txth trace file format */
+    OSI_ZST,      /**< .osi trace file format, zstd compressed */
+    OSI_LZ4,      /**< .osi trace file format, lz4 compressed */
+};
+
+enum class McapCompression : u_int8_t
+{
+    kZstd = 0, /**< zstd chunk compression (default) */
+    kLz4,      /**< lz4 chunk compression */
+    kNone,     /**< uncompressed chunks */
+};
+
+/** Additional input stream, recorded as its own channel of an MCAP trace file */
+struct TraceChannel
+{
+    std::string message_type;  // OSI message type short name (sv, sd, gt)
+    std::string topic;
+};
+
+enum class McapLogTime : u_int8_t
+{
+    kOsiTimestamp = 0, /**< log and publish time are the OSI timestamp of the message (default) */
+    kSimulationTime,   /**< log time is the simulation time, publish time the OSI timestamp */
+};
+
+/** Optional recording settings, the defaults write every frame synchronously in Step() */
+struct TraceFileWriterOptions
+{
+    /** frames buffered for the writer thread, 0 disables the writer thread */
+    size_t queue_depth = 0;
+    QueueOverflowPolicy queue_overflow_policy = QueueOverflowPolicy::kBlock;
+
+    McapCompression mcap_compression = McapCompression::kZstd;
+    /** zstd/lz4 level, mapped to the nearest level of the MCAP writer */
+    int mcap_compression_level = 0;
+    /** uncompressed MCAP chunk size in bytes, 0 uses the MCAP writer default */
+    uint64_t mcap_chunk_size = 0;
+    /** threads compressing MCAP chunks in parallel, 0 compresses on the writing thread */
+    size_t mcap_compression_threads = 0;
+    /** source of the MCAP log time, which the chunk and message indexes of the summary are built from */
+    McapLogTime mcap_log_time = McapLogTime::kOsiTimestamp;
+    /** record the static map content of GroundTruth on a separate MCAP channel, only when it changes */
+    bool split_static_ground_truth = false;
+    /** comma separated field paths of the main input that are recorded, e.g. "moving_object.base,lane.id", empty records everything */
+    std::string field_mask;
+
+    /** write .osi files through a preallocated memory mapping instead of stream writes */
+    bool mmap_output = false;
+    /** write .osi and .mcap files asynchronously with Linux io_uring on the writer thread, falls back to the other outputs if not available */
+    bool io_uring_output = false;
+    /** bypass the page cache (O_DIRECT) with io_uring_output */
+    bool direct_io = false;
+    /** write a .idx sidecar frame index next to .osi, .osi.zst and .osi.lz4 files */
+    bool osi_index = false;
+
+    /** start a new trace file segment before it exceeds this many bytes of serialized frames, 0 disables */
+    uint64_t segment_max_bytes = 0;
+    /** start a new trace file segment after this many frames, 0 disables */
+    size_t segment_max_frames = 0;
+    /** start a new trace file segment after this many simulated seconds, 0 disables */
+    double segment_max_duration = 0.0;
+
+    /** keep frames in memory and only write them around a Trigger(), each trigger event is written to a new segment */
+    bool trigger_mode = false;
+    /** simulated seconds of frames before the trigger that are written */
+    double pre_trigger_duration = 0.0;
+    /** limit of the frames kept before the trigger in bytes, 0 disables */
+    uint64_t pre_trigger_max_bytes = 0;
+    /** simulated seconds after the last trigger that are written */
+    double post_trigger_duration = 0.0;
+
+    /** write a checkpoint for the recovery of the trace file after a crash every this many simulated seconds, 0 disables */
+    double checkpoint_interval = 0.0;
+
+    /** threads formatting .txth frames in parallel, 0 formats on the writing thread */
+    size_t txth_format_threads = 0;
+
+    /** skip a frame whose serialized bytes repeat the previous frame of its channel, detected by a 64 bit content hash */
+    bool deduplicate_frames = false;
+
+    /**
+     * name of a local trace_sink process the frames are handed to instead of writing the trace file in this process, empty writes it here.
+     * The sink writes to the trace path of this writer with its own recording options, so the file is written here if any of those is set
+     */
+    std::string sink_name;
+    /** size of the shared memory ring to the sink in bytes, frames up to half of it can be handed over. 0 uses 32 MiB */
+    uint64_t sink_ring_bytes = 0;
+
+    /** MCAP topic of the main input, empty uses sl-5-6-osi-trace-file-writer */
+    std::string topic;
+    /** further inputs interleaved into the same MCAP file, selected with the channel argument of Step() */
+    std::vector<TraceChannel> additional_channels;
+};
+
+/** Recording statistics of a TraceFileWriter, see TraceFileWriter::Statistics() */
+struct TraceFileWriterStatistics
+{
+    double last_step_seconds = 0.0;  // wall clock duration of the last Step() call
+    double mean_step_seconds = 0.0;
+    double max_step_seconds = 0.0;
+    uint64_t frames_written = 0;       // frames handed to the trace file writer, including all segments
+    uint64_t bytes_written = 0;        // serialized bytes of the written frames
+    uint64_t frames_dropped = 0;       // frames dropped by the overflow policy of the writer thread queue
+    uint64_t frames_deduplicated = 0;  // frames skipped because they repeated the previous frame of their channel
+    size_t queue_size = 0;             // frames currently waiting for the writer thread
+};
+
+class TraceSinkClient;
+
+/** Format agnostic per-frame write path, selected once in TraceFileWriter::Init() */
+class IFrameWriter
+{
+  public:
+    virtual ~IFrameWriter() = default;
+    virtual bool Write(const void* data, int size, double sim_time) = 0;
 };
 
 class TraceFileWriter
 {
   public:
-    void Init(const std::string& trace_path, std::string protobuf_version, std::string custom_name, std::string message_type, FileFormat file_format, bool omit_timestamp);
-    bool Step(const void* data, int size);
-    void Term() const;
+    TraceFileWriter();
+    ~TraceFileWriter();
+    void Init(const std::string& trace_path,
+              std::string protobuf_version,
+              std::string custom_name,
+              std::string message_type,
+              FileFormat file_format,
+              bool omit_timestamp,
+              const TraceFileWriterOptions& options = {});
+    /**
+     * Write (or queue) one serialized OSI message.
+     *
+     * \param channel 0 for the main input, 1 + index into TraceFileWriterOptions::additional_channels otherwise
+     */
+    bool Step(const void* data, int size, double sim_time = 0.0, size_t channel = 0);
+    /** Write the buffered pre-trigger frames and record until post_trigger_duration after sim_time, only used in trigger mode */
+    bool Trigger(double sim_time);
+    void Term();
+
+    /** Highest number of frame buffers in use at the same time by the writer thread queue */
+    size_t FramePoolHighWaterMark() const { return frame_buffer_pool_.HighWaterMark(); }
+    /** Step() latency and throughput since Init(), may be called while the writer thread is running */
+    TraceFileWriterStatistics Statistics() const;
 
   private:
     FileFormat file_format_ = FileFormat::kUnknown;
     std::unique_ptr<osi3::TraceFileWriter> writer_;
-    std::function<bool(const void*, int)> serialized_writer_function_;
-    std::function<bool(const void*, int)> writer_function_consecutive_;
+    std::vector<TraceChannel> channels_;
+    std::vector<std::unique_ptr<IFrameWriter>> frame_writers_;  // indexed by channel
+
+    // asynchronous writing: Step() only queues a copy of the frame, the writer thread does the file I/O
+    FrameBufferPool frame_buffer_pool_;
+    std::unique_ptr<FrameQueue> frame_queue_;
+    std::thread writer_thread_;
+    std::atomic<bool> write_failed_{false};
+
+    // statistics: the frame counters are updated by the writing thread, the step durations by the caller of Step()
+    std::atomic<uint64_t> frames_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    uint64_t num_steps_ = 0;
+    double last_step_seconds_ = 0.0;
+    double total_step_seconds_ = 0.0;
+    double max_step_seconds_ = 0.0;
+    uint64_t frames_deduplicated_ = 0;
+
+    // frame deduplication: size and content hash of the last frame handed on per channel, only used by the caller of Step()
+    struct LastFrame
+    {
+        bool valid = false;
+        int size = 0;
+        uint64_t hash = 0;
+    };
+    std::vector<LastFrame> last_frames_;
+
+    // trace file rotation: a finished segment is closed and renamed on a worker thread, while the next one is already written
+    std::unique_ptr<WorkerPool> segment_finalizer_;
+    std::vector<std::future<void>> segment_finalized_;
+    size_t segment_index_ = 0;
+    uint64_t segment_bytes_ = 0;
+    double segment_start_time_ = 0.0;
+
+    // trigger mode: frames outside of the trigger window are only kept in the pre-trigger buffer
+    std::unique_ptr<PreTriggerBuffer> pre_trigger_buffer_;
+    bool trigger_active_ = false;
+    bool start_segment_pending_ = false;
+    double post_trigger_end_ = 0.0;
 
+    // crash recovery: the trace file state is written to a sidecar by the writing thread
+    double next_checkpoint_time_ = 0.0;
+
+    // trace sink: the frames are only handed to the trace_sink process, which writes the file with its own options
+    std::unique_ptr<TraceSinkClient> sink_client_;
+
+    TraceFileWriterOptions options_;
     std::filesystem::path path_trace_folder_;
     std::filesystem::path path_trace_temp_;
     bool omit_timestamp_;
@@ -43,90 +230,33 @@ class TraceFileWriter
     std::string protobuf_version_;
     std::string custom_name_;
     std::string type_;
+    bool StepFrame(const void* data, int size, double sim_time, size_t channel);
+    bool RepeatsLastFrame(const void* data, int size, size_t channel);
+    bool WriteFrame(const void* data, int size, double sim_time, size_t channel, bool starts_segment);
+    bool WriteBufferedFrame(std::unique_ptr<FrameBuffer> frame);
+    void RunWriterThread();
+    void StopWriterThread();
+    bool WriteCheckpoint();
+    bool SegmentLimitReached(int size, double sim_time) const;
+    bool RotateSegment();
+    bool CheckFinalizedSegments(bool wait);
+    void SetStartTime();
     void SetFileName();
+    std::string FileNameSuffix() const;
+    std::string FinalFileNamePrefix() const;
+    std::filesystem::path FinalTracePath() const;
+    bool HasOsiIndex() const;
+    static void RenameTraceFile(const std::filesystem::path& temp_path, const std::filesystem::path& final_path, bool has_index);
+    static void RemoveTraceFile(const std::filesystem::path& temp_path, bool has_index);
     void SetupDeserializedWriterFunction();
     template <class T>
-    void setupForMessageType();
+    std::unique_ptr<IFrameWriter> setupForMessageType(const std::string& topic, std::string* osi_version);
     void SetupWriter();
 
     const std::unordered_map<FileFormat, std::string> kFileNameMessageTypeMap = {{FileFormat::kUnknown, ".unknown"},
                                                                                  {FileFormat::MCAP, ".mcap"},
                                                                                  {FileFormat::OSI, ".osi"},
-                                                                                 {FileFormat::TXTH, ".txth"}};
-
-    /* Private File-based Logging just for Debugging */
-#ifdef PRIVATE_LOG_PATH
-    static ofstream private_log_file;
-#endif
-
-    static void FmiVerboseLogGlobal(const char* format, ...)
-    {
-#ifdef VERBOSE_FMI_LOGGING
-#ifdef PRIVATE_LOG_PATH
-        va_list ap;
-        va_start(ap, format);
-        char buffer[1024];
-        if (!private_log_file.is_open())
-            private_log_file.open(PRIVATE_LOG_PATH, ios::out | ios::app);
-        if (private_log_file.is_open())
-        {
-#ifdef _WIN32
-            vsnprintf_s(buffer, 1024, format, ap);
-#else
-            vsnprintf(buffer, 1024, format, ap);
-#endif
-            private_log_file << "OSMPDummySensor"
-                             << "::Global:FMI: " << buffer << endl;
-            private_log_file.flush();
-        }
-#endif
-#endif
-    }
-
-    void InternalLog(const char* category, const char* format, va_list arg)
-    {
-#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
-        char buffer[1024];
-#ifdef _WIN32
-        vsnprintf_s(buffer, 1024, format, arg);
-#else
-        vsnprintf(buffer, 1024, format, arg);
-#endif
-#ifdef PRIVATE_LOG_PATH
-        if (!private_log_file.is_open())
-            private_log_file.open(PRIVATE_LOG_PATH, ios::out | ios::app);
-        if (private_log_file.is_open())
-        {
-            private_log_file << "OSMPDummySensor"
-                             << "::" << instanceName << "<" << ((void*)this) << ">:" << category << ": " << buffer << endl;
-            private_log_file.flush();
-        }
-#endif
-#ifdef PUBLIC_LOGGING
-        if (loggingOn && loggingCategories.count(category))
-            functions.logger(functions.componentEnvironment, instanceName.c_str(), fmi2OK, category, buffer);
-#endif
-#endif
-    }
-
-    void FmiVerboseLog(const char* format, ...)
-    {
-#if defined(VERBOSE_FMI_LOGGING) && (defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING))
-        va_list ap;
-        va_start(ap, format);
-        internal_log("FMI", format, ap);
-        va_end(ap);
-#endif
-    }
-
-    /* Normal Logging */
-    void NormalLog(const char* category, const char* format, ...)
-    {
-#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
-        va_list ap;
-        va_start(ap, format);
-        internal_log(category, format, ap);
-        va_end(ap);
-#endif
-    }
+                                                                                 {FileFormat::TXTH, ".txth"},
+                                                                                 {FileFormat::OSI_ZST, ".osi.zst"},
+                                                                                 {FileFormat::OSI_LZ4, ".osi.lz4"}};
 };
\ No newline at end of file
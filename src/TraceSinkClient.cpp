@@ -0,0 +1,173 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "TraceSinkClient.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr std::chrono::milliseconds kSinkPollInterval{100};
+
+/** Copy a string into a fixed size field with terminating zero, fails if it does not fit */
+template <size_t N>
+bool CopyField(char (&field)[N], const std::string& value)
+{
+    if (value.size() >= N)
+    {
+        return false;
+    }
+    std::memset(field, 0, N);
+    std::memcpy(field, value.data(), value.size());
+    return true;
+}
+
+int32_t CurrentProcessId()
+{
+#ifdef __linux__
+    return static_cast<int32_t>(getpid());
+#else
+    return 0;
+#endif
+}
+}  // namespace
+
+bool TraceSinkControl::ValidSinkName(const std::string& sink_name)
+{
+    // leaves room for the slot index and process id in the ring names
+    return !sink_name.empty() && sink_name.size() <= 48 &&
+           std::all_of(sink_name.begin(), sink_name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '-' || c == '_'; });
+}
+
+void TraceSinkControl::WakeSink()
+{
+    if (sink_sleeping.load(std::memory_order_seq_cst) != 0)
+    {
+        doorbell.fetch_add(1, std::memory_order_seq_cst);
+        ShmFutexWake(doorbell);
+    }
+}
+
+TraceSinkClient::~TraceSinkClient()
+{
+    Close();
+}
+
+bool TraceSinkClient::Connect(const std::string& sink_name,
+                              const std::filesystem::path& trace_path,
+                              const std::string& protobuf_version,
+                              const std::string& custom_name,
+                              FileFormat file_format,
+                              bool omit_timestamp,
+                              const std::vector<TraceChannel>& channels,
+                              size_t ring_capacity)
+{
+    if (!TraceSinkControl::ValidSinkName(sink_name) || channels.empty() || channels.size() > kTraceSinkMaxChannels)
+    {
+        return false;
+    }
+    if (!control_segment_.Open(TraceSinkControl::SegmentName(sink_name)) || control_segment_.Size() < sizeof(TraceSinkControl))
+    {
+        return false;
+    }
+    control_ = static_cast<TraceSinkControl*>(control_segment_.Data());
+    // the sink runs in another working directory
+    std::error_code error;
+    const std::filesystem::path absolute_trace_path = trace_path.empty() ? trace_path : std::filesystem::absolute(trace_path, error);
+    if (error)
+    {
+        return false;
+    }
+    if (!ProcessAlive(control_->sink_pid.load(std::memory_order_acquire)) || std::memcmp(control_->magic, TraceSinkControl::kMagic, sizeof(TraceSinkControl::kMagic)) != 0)
+    {
+        return false;
+    }
+
+    const int32_t pid = CurrentProcessId();
+    for (size_t slot_index = 0; slot_index < kTraceSinkMaxInstances; slot_index++)
+    {
+        auto& slot = control_->slots[slot_index];
+        auto expected = static_cast<uint32_t>(TraceSinkSlotState::kFree);
+        if (!slot.state.compare_exchange_strong(expected, static_cast<uint32_t>(TraceSinkSlotState::kClaimed), std::memory_order_acq_rel))
+        {
+            continue;
+        }
+
+        const std::string ring_name = TraceSinkControl::SegmentName(sink_name) + "." + std::to_string(slot_index) + "." + std::to_string(pid);
+        // a ring of a crashed process with the same pid may still exist
+        ShmSegment::Unlink(ring_name);
+        bool filled = ring_.Create(ring_name, ring_capacity > 0 ? ring_capacity : ShmFrameRing::kDefaultCapacity) && CopyField(slot.ring_name, ring_name) &&
+                      CopyField(slot.trace_path, absolute_trace_path.string()) && CopyField(slot.protobuf_version, protobuf_version) &&
+                      CopyField(slot.custom_name, custom_name);
+        for (size_t channel = 0; filled && channel < channels.size(); channel++)
+        {
+            filled = CopyField(slot.channels[channel].message_type, channels[channel].message_type) && CopyField(slot.channels[channel].topic, channels[channel].topic);
+        }
+        if (!filled)
+        {
+            std::cerr << "Could not register at trace sink " << sink_name << std::endl;
+            ring_.Unlink();
+            slot.state.store(static_cast<uint32_t>(TraceSinkSlotState::kFree), std::memory_order_release);
+            return false;
+        }
+        slot.pid = pid;
+        slot.file_format = static_cast<uint32_t>(file_format);
+        slot.omit_timestamp = omit_timestamp ? 1 : 0;
+        slot.num_channels = static_cast<uint32_t>(channels.size());
+        slot.state.store(static_cast<uint32_t>(TraceSinkSlotState::kActive), std::memory_order_release);
+        control_->WakeSink();
+        connected_ = true;
+        return true;
+    }
+    std::cerr << "All " << kTraceSinkMaxInstances << " slots of trace sink " << sink_name << " are taken" << std::endl;
+    return false;
+}
+
+bool TraceSinkClient::Push(const void* data, int size, size_t channel, double sim_time)
+{
+    if (!connected_ || size < 0)
+    {
+        return false;
+    }
+    if (!ring_.Fits(static_cast<size_t>(size)))
+    {
+        std::cerr << "Frame of " << size << " bytes is larger than half of the trace sink ring, increase sink_ring_size_mb" << std::endl;
+        return false;
+    }
+    // the sink closes the ring if it could not open the trace file or stops, frames pushed after that would never be written
+    if (ring_.ConsumerClosed())
+    {
+        return false;
+    }
+    while (!ring_.TryPush(data, static_cast<uint32_t>(size), static_cast<uint32_t>(channel), sim_time))
+    {
+        if (ring_.ConsumerClosed() || !ProcessAlive(control_->sink_pid.load(std::memory_order_relaxed)))
+        {
+            return false;
+        }
+        control_->WakeSink();
+        ring_.WaitForSpace(static_cast<uint32_t>(size), kSinkPollInterval);
+    }
+    control_->WakeSink();
+    return true;
+}
+
+void TraceSinkClient::Close()
+{
+    if (!connected_)
+    {
+        return;
+    }
+    connected_ = false;
+    ring_.CloseProducer();
+    control_->WakeSink();
+}
@@ -0,0 +1,105 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ShmFrameRing.h"
+#include "TraceFileWriter.h"
+
+constexpr size_t kTraceSinkMaxInstances = 64;
+constexpr size_t kTraceSinkMaxChannels = 4;  // main input and the additional inputs of the FMU
+
+enum class TraceSinkSlotState : uint32_t
+{
+    kFree = 0, /**< available for a new instance */
+    kClaimed,  /**< being filled by an instance */
+    kActive,   /**< ring and metadata are complete, read by the sink */
+};
+
+struct TraceSinkChannel
+{
+    char message_type[8];
+    char topic[120];
+};
+
+/** Registration of one FMU instance at the sink, fixed once the state is kActive */
+struct TraceSinkSlot
+{
+    std::atomic<uint32_t> state;
+    int32_t pid;
+    uint32_t file_format;
+    uint32_t omit_timestamp;
+    uint32_t num_channels;
+    char ring_name[64];
+    char trace_path[512];  // absolute, empty writes to the trace folder of the sink
+    char protobuf_version[32];
+    char custom_name[128];
+    TraceSinkChannel channels[kTraceSinkMaxChannels];
+};
+
+/**
+ * Shared memory segment "/<sink name>" created by the trace_sink process. FMU instances claim a slot,
+ * create their own ShmFrameRing and wake the sink through the doorbell futex when it is sleeping.
+ * sink_pid is set last by the sink and cleared when it exits.
+ */
+struct TraceSinkControl
+{
+    char magic[8];
+    std::atomic<int32_t> sink_pid;
+    std::atomic<uint32_t> doorbell;  // futex word of the sink, incremented for a sleeping sink
+    std::atomic<uint32_t> sink_sleeping;
+    TraceSinkSlot slots[kTraceSinkMaxInstances];
+
+    static constexpr char kMagic[8] = {'O', 'S', 'I', 'S', 'I', 'N', 'K', '1'};
+
+    static std::string SegmentName(const std::string& sink_name) { return "/" + sink_name; }
+    /** Letters, digits, '-' and '_' only, so the sink name is a valid shared memory name */
+    static bool ValidSinkName(const std::string& sink_name);
+
+    /** Wake the sink if it sleeps, called after frames were pushed or a ring was added or closed */
+    void WakeSink();
+};
+
+/**
+ * FMU side of the trace sink: hands the frames of one TraceFileWriter to a local trace_sink process,
+ * which writes the trace file instead of this process.
+ */
+class TraceSinkClient
+{
+  public:
+    TraceSinkClient() = default;
+    ~TraceSinkClient();
+    TraceSinkClient(const TraceSinkClient&) = delete;
+    TraceSinkClient& operator=(const TraceSinkClient&) = delete;
+
+    /** Register at the sink, fails if no sink with this name runs or all slots are taken. ring_capacity 0 uses the default */
+    bool Connect(const std::string& sink_name,
+                 const std::filesystem::path& trace_path,
+                 const std::string& protobuf_version,
+                 const std::string& custom_name,
+                 FileFormat file_format,
+                 bool omit_timestamp,
+                 const std::vector<TraceChannel>& channels,
+                 size_t ring_capacity = 0);
+
+    /** Hand one serialized message to the sink, blocks while the ring is full. Fails for messages larger than half of the ring */
+    bool Push(const void* data, int size, size_t channel, double sim_time);
+
+    /** Mark the end of the recording, the sink finalizes the trace file once it wrote all frames */
+    void Close();
+
+  private:
+    ShmSegment control_segment_;
+    TraceSinkControl* control_ = nullptr;
+    ShmFrameRing ring_;
+    bool connected_ = false;
+};
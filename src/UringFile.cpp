@@ -0,0 +1,428 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "UringFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define URING_FILE_SUPPORTED
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// upper bound of the logical block size, O_DIRECT needs buffer addresses, sizes and file offsets aligned to it
+constexpr size_t kAlignment = 4096;
+// the length of a single write is 32 bit
+constexpr size_t kMaxBufferSize = size_t{1} << 30U;
+}  // namespace
+
+#ifdef URING_FILE_SUPPORTED
+
+/** Submission and completion rings shared with the kernel */
+struct UringFile::Ring
+{
+    int fd = -1;
+    void* sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    void* cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+    void* sqes = MAP_FAILED;
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    bool registered_buffers = false;
+    std::vector<iovec> iovecs;  // by buffer, also used by vectored writes if the buffers could not be registered
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)
+        {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+        {
+            munmap(cq_ring, cq_ring_size);
+        }
+        if (sq_ring != MAP_FAILED)
+        {
+            munmap(sq_ring, sq_ring_size);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    bool Setup(unsigned entries)
+    {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+        {
+            return false;
+        }
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0U;
+        if (single_mmap)
+        {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED)
+        {
+            return false;
+        }
+        cq_ring = single_mmap ? sq_ring : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            return false;
+        }
+
+        auto* sq = static_cast<char*>(sq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto* cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    /** \return number of consumed submissions, negative on errors */
+    long Enter(unsigned to_submit, unsigned min_complete, unsigned flags) const
+    {
+        long result = 0;
+        do
+        {
+            result = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+        } while (result < 0 && errno == EINTR);
+        return result;
+    }
+};
+
+UringFile::UringFile() = default;
+
+UringFile::~UringFile()
+{
+    Close();
+}
+
+bool UringFile::Open(const std::filesystem::path& file_path, bool direct_io, size_t buffer_size, size_t num_buffers)
+{
+    Close();
+    buffer_size_ = std::min(std::max((buffer_size + kAlignment - 1) / kAlignment * kAlignment, kAlignment), kMaxBufferSize);
+    num_buffers = std::max(num_buffers, size_t{1});
+
+    constexpr int kFlags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    direct_io_ = false;
+    if (direct_io)
+    {
+        // not supported by every file system (e.g. tmpfs), buffered I/O is used there
+        fd_ = open(file_path.c_str(), kFlags | O_DIRECT, 0644);
+        direct_io_ = fd_ >= 0;
+    }
+    if (fd_ < 0)
+    {
+        fd_ = open(file_path.c_str(), kFlags, 0644);
+    }
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    ring_ = std::make_unique<Ring>();
+    buffer_memory_ = static_cast<char*>(std::aligned_alloc(kAlignment, buffer_size_ * num_buffers));
+    if (!ring_->Setup(static_cast<unsigned>(num_buffers)) || buffer_memory_ == nullptr)
+    {
+        Release();
+        return false;
+    }
+    ring_->iovecs.resize(num_buffers);
+    for (size_t buffer = 0; buffer < num_buffers; buffer++)
+    {
+        ring_->iovecs[buffer] = {buffer_memory_ + buffer * buffer_size_, buffer_size_};
+    }
+    // registered buffers are mapped into the kernel once instead of for every write, this fails if they exceed RLIMIT_MEMLOCK
+    ring_->registered_buffers = syscall(__NR_io_uring_register, ring_->fd, IORING_REGISTER_BUFFERS, ring_->iovecs.data(), static_cast<unsigned>(num_buffers)) == 0;
+
+    free_buffers_.clear();
+    for (size_t buffer = num_buffers; buffer > 1; buffer--)
+    {
+        free_buffers_.push_back(buffer - 1);
+    }
+    in_flight_lengths_.assign(num_buffers, 0);
+    num_queued_ = 0;
+    num_in_flight_ = 0;
+    current_buffer_ = 0;
+    current_fill_ = 0;
+    current_offset_ = 0;
+    written_size_ = 0;
+    failed_ = false;
+    return true;
+}
+
+bool UringFile::Write(const void* data, size_t size)
+{
+    if (fd_ < 0 || failed_)
+    {
+        return false;
+    }
+    const auto* source = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const size_t piece = std::min(size, buffer_size_ - current_fill_);
+        std::memcpy(buffer_memory_ + current_buffer_ * buffer_size_ + current_fill_, source, piece);
+        source += piece;
+        size -= piece;
+        current_fill_ += piece;
+        written_size_ += piece;
+        if (current_fill_ == buffer_size_)
+        {
+            QueueBuffer(current_buffer_, current_offset_, buffer_size_);
+            current_offset_ += buffer_size_;
+            current_fill_ = 0;
+            if (!AcquireBuffer())
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool UringFile::Close()
+{
+    if (fd_ < 0)
+    {
+        return true;
+    }
+    if (current_fill_ > 0 && !failed_)
+    {
+        QueueCurrentBuffer();
+    }
+    while ((num_queued_ > 0 || num_in_flight_ > 0) && Submit(true))
+    {
+        ReapCompletions();
+    }
+    bool success = !failed_ && num_queued_ == 0 && num_in_flight_ == 0;
+    if (direct_io_)
+    {
+        // remove the padding of the last write
+        success = ftruncate(fd_, static_cast<off_t>(written_size_)) == 0 && success;
+    }
+    return Release() && success;
+}
+
+bool UringFile::Flush()
+{
+    if (fd_ < 0 || failed_)
+    {
+        return false;
+    }
+    // the current buffer stays current: it is written again from its start once it is full
+    if (current_fill_ > 0)
+    {
+        QueueCurrentBuffer();
+    }
+    while ((num_queued_ > 0 || num_in_flight_ > 0) && Submit(true))
+    {
+        ReapCompletions();
+    }
+    free_buffers_.erase(std::remove(free_buffers_.begin(), free_buffers_.end(), current_buffer_), free_buffers_.end());
+    return !failed_ && num_queued_ == 0 && num_in_flight_ == 0;
+}
+
+void UringFile::QueueCurrentBuffer()
+{
+    size_t length = current_fill_;
+    if (direct_io_)
+    {
+        length = (length + kAlignment - 1) / kAlignment * kAlignment;
+        std::memset(buffer_memory_ + current_buffer_ * buffer_size_ + current_fill_, 0, length - current_fill_);
+    }
+    QueueBuffer(current_buffer_, current_offset_, length);
+}
+
+void UringFile::QueueBuffer(size_t buffer, uint64_t offset, size_t length)
+{
+    Ring& ring = *ring_;
+    const unsigned tail = *ring.sq_tail;  // only written by this thread
+    const unsigned index = tail & *ring.sq_mask;
+    auto& sqe = static_cast<io_uring_sqe*>(ring.sqes)[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    if (ring.registered_buffers)
+    {
+        sqe.opcode = IORING_OP_WRITE_FIXED;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer_memory_ + buffer * buffer_size_);
+        sqe.len = static_cast<uint32_t>(length);
+        sqe.buf_index = static_cast<uint16_t>(buffer);
+    }
+    else
+    {
+        ring.iovecs[buffer].iov_len = length;
+        sqe.opcode = IORING_OP_WRITEV;
+        sqe.addr = reinterpret_cast<uint64_t>(&ring.iovecs[buffer]);
+        sqe.len = 1;
+    }
+    sqe.fd = fd_;
+    sqe.off = offset;
+    sqe.user_data = buffer;
+    ring.sq_array[index] = index;
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    in_flight_lengths_[buffer] = static_cast<uint32_t>(length);
+    num_queued_++;
+}
+
+bool UringFile::Submit(bool wait)
+{
+    const long result = ring_->Enter(static_cast<unsigned>(num_queued_), wait ? 1U : 0U, wait ? IORING_ENTER_GETEVENTS : 0U);
+    if (result < 0)
+    {
+        failed_ = true;
+        return false;
+    }
+    // writes the kernel did not take stay in the submission ring and are never waited for
+    const auto submitted = static_cast<size_t>(result);
+    num_in_flight_ += submitted;
+    if (submitted != num_queued_)
+    {
+        failed_ = true;
+    }
+    num_queued_ = 0;
+    return !failed_;
+}
+
+bool UringFile::AcquireBuffer()
+{
+    ReapCompletions();
+    if (free_buffers_.empty())
+    {
+        // every buffer is queued or in flight: one syscall submits the queued writes and waits for the first completion
+        if (Submit(true))
+        {
+            ReapCompletions();
+        }
+    }
+    if (failed_ || free_buffers_.empty())
+    {
+        return false;
+    }
+    current_buffer_ = free_buffers_.back();
+    free_buffers_.pop_back();
+    return true;
+}
+
+void UringFile::ReapCompletions()
+{
+    Ring& ring = *ring_;
+    unsigned head = *ring.cq_head;  // only written by this thread
+    const unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        const io_uring_cqe& cqe = ring.cqes[head & *ring.cq_mask];
+        const auto buffer = static_cast<size_t>(cqe.user_data);
+        // a short write to a regular file only happens on errors like a full disk
+        if (cqe.res < 0 || static_cast<uint32_t>(cqe.res) != in_flight_lengths_[buffer])
+        {
+            failed_ = true;
+        }
+        in_flight_lengths_[buffer] = 0;
+        num_in_flight_--;
+        free_buffers_.push_back(buffer);
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+bool UringFile::Release()
+{
+    // the ring goes first, the kernel may still reference the buffers until then
+    ring_.reset();
+    std::free(buffer_memory_);
+    buffer_memory_ = nullptr;
+    const bool closed = fd_ < 0 || close(fd_) == 0;
+    fd_ = -1;
+    return closed;
+}
+
+#else
+
+struct UringFile::Ring
+{
+};
+
+UringFile::UringFile() = default;
+
+UringFile::~UringFile() = default;
+
+bool UringFile::Open(const std::filesystem::path& /*file_path*/, bool /*direct_io*/, size_t /*buffer_size*/, size_t /*num_buffers*/)
+{
+    return false;
+}
+
+bool UringFile::Write(const void* /*data*/, size_t /*size*/)
+{
+    return false;
+}
+
+bool UringFile::Close()
+{
+    return true;
+}
+
+bool UringFile::Flush()
+{
+    return false;
+}
+
+void UringFile::QueueBuffer(size_t /*buffer*/, uint64_t /*offset*/, size_t /*length*/)
+{
+}
+
+void UringFile::QueueCurrentBuffer()
+{
+}
+
+bool UringFile::Submit(bool /*wait*/)
+{
+    return false;
+}
+
+bool UringFile::AcquireBuffer()
+{
+    return false;
+}
+
+void UringFile::ReapCompletions()
+{
+}
+
+bool UringFile::Release()
+{
+    return true;
+}
+
+#endif
@@ -0,0 +1,89 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+/**
+ * Output file that is written asynchronously with Linux io_uring instead of blocking stream writes.
+ *
+ * Data is copied into a small set of aligned buffers that are registered with the kernel once.
+ * A filled buffer is queued as a single write at its file offset in the submission ring and the next
+ * free buffer is filled meanwhile. The queued writes are handed to the kernel together with one syscall
+ * once no buffer is free, which also waits for the first completion, or on Flush() and Close(), so the
+ * writing thread only blocks when all buffers are in flight. Completions are reaped from the completion
+ * ring without a syscall. With direct I/O the page cache is bypassed,
+ * the last partial buffer is padded to the alignment and Close() truncates the file to its written size.
+ * The io_uring syscalls are used directly, Open() fails if the kernel (or a seccomp filter) does not
+ * provide them and on other systems than Linux.
+ *
+ * There is no completion thread, writes are submitted and completions are reaped by the thread calling
+ * Write(), Flush() and Close(). The trace file writer therefore always writes io_uring output on its
+ * writer thread, never on the Step() thread.
+ */
+class UringFile
+{
+  public:
+    static constexpr size_t kDefaultBufferSize = 1024 * 1024;
+    static constexpr size_t kDefaultNumBuffers = 8;
+
+    UringFile();
+    ~UringFile();
+    UringFile(const UringFile&) = delete;
+    UringFile& operator=(const UringFile&) = delete;
+
+    /**
+     * \param file_path file to create or truncate
+     * \param direct_io open the file with O_DIRECT, falls back to buffered I/O if the file system does not support it
+     * \param buffer_size size of each write, rounded up to the direct I/O alignment
+     * \param num_buffers maximum number of writes in flight
+     */
+    bool Open(const std::filesystem::path& file_path, bool direct_io = false, size_t buffer_size = kDefaultBufferSize, size_t num_buffers = kDefaultNumBuffers);
+    bool IsOpen() const { return fd_ >= 0; }
+    bool Write(const void* data, size_t size);
+    /** Number of bytes written so far, including the ones not yet submitted */
+    uint64_t Size() const { return written_size_; }
+    /** True if a submitted write failed, the file is incomplete then */
+    bool Failed() const { return failed_; }
+
+    /** Write the data so far to the file and wait for it, e.g. so that it survives a crash of the process */
+    bool Flush();
+
+    /** Submit the remaining data, wait for all writes and close the file */
+    bool Close();
+
+  private:
+    struct Ring;
+
+    /** Add a write of the buffer to the submission ring, it is handed to the kernel by the next Submit() */
+    void QueueBuffer(size_t buffer, uint64_t offset, size_t length);
+    /** Queue the partially filled current buffer, padded to the alignment with direct I/O */
+    void QueueCurrentBuffer();
+    /** Hand all queued writes to the kernel with a single syscall, optionally waiting for at least one completion */
+    bool Submit(bool wait);
+    bool AcquireBuffer();
+    void ReapCompletions();
+    bool Release();
+
+    int fd_ = -1;
+    bool direct_io_ = false;
+    std::unique_ptr<Ring> ring_;
+    size_t buffer_size_ = 0;
+    char* buffer_memory_ = nullptr;  // all buffers, aligned and contiguous
+    std::vector<size_t> free_buffers_;
+    std::vector<uint32_t> in_flight_lengths_;  // by buffer, 0 if the buffer is not in flight
+    size_t num_queued_ = 0;     // writes in the submission ring, not yet handed to the kernel
+    size_t num_in_flight_ = 0;  // writes handed to the kernel, not yet completed
+    size_t current_buffer_ = 0;
+    size_t current_fill_ = 0;
+    uint64_t current_offset_ = 0;  // file offset of the current buffer
+    uint64_t written_size_ = 0;
+    bool failed_ = false;
+};
@@ -0,0 +1,77 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t num_threads)
+{
+    num_threads = std::max<size_t>(num_threads, 1);
+    threads_.reserve(num_threads);
+    try
+    {
+        for (size_t i = 0; i < num_threads; i++)
+        {
+            threads_.emplace_back(&WorkerPool::Run, this);
+        }
+    }
+    catch (...)
+    {
+        // join the threads that did start, the destructor does not run for a throwing constructor
+        Stop();
+        throw;
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    task_available_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+std::future<void> WorkerPool::Submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged_task(std::move(task));
+    auto future = packaged_task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(packaged_task));
+    }
+    task_available_.notify_one();
+    return future;
+}
+
+void WorkerPool::Run()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_available_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            // remaining tasks are still run on shutdown, so no future is left without a result
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,42 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Small fixed-size thread pool for CPU heavy work of the writers, e.g. chunk compression.
+ * Tasks are started in submission order, the caller keeps the order of the results by
+ * waiting on the returned futures in the same order.
+ */
+class WorkerPool
+{
+  public:
+    explicit WorkerPool(size_t num_threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    std::future<void> Submit(std::function<void()> task);
+
+    size_t NumThreads() const { return threads_.size(); }
+
+  private:
+    void Run();
+    void Stop();
+
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
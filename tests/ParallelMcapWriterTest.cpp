@@ -0,0 +1,103 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ParallelMcapWriter.h"
+
+namespace
+{
+constexpr size_t kNumMessages = 200;
+constexpr uint64_t kChunkSize = 16 * 1024;
+
+/** Compressible payload of varying size, so the file has many chunks of different length */
+std::string Payload(size_t index)
+{
+    std::string payload(512 + (index * 97) % 4096, static_cast<char>('a' + index % 26));
+    payload.replace(0, std::to_string(index).size(), std::to_string(index));
+    return payload;
+}
+
+bool Check(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << message << std::endl;
+    }
+    return condition;
+}
+
+bool RoundTrip(const std::filesystem::path& path, mcap::Compression compression)
+{
+    {
+        mcap::McapWriterOptions options("");
+        options.compression = compression;
+        options.chunkSize = kChunkSize;
+        ParallelMcapWriter writer;
+        if (!Check(writer.Open(path.string(), options, 2).ok(), "could not open " + path.string()))
+        {
+            return false;
+        }
+        mcap::Schema schema("osi3.GroundTruth", "protobuf", "");
+        writer.AddSchema(schema);
+        mcap::Channel channel("gt", "protobuf", schema.id);
+        writer.AddChannel(channel);
+        for (size_t index = 0; index < kNumMessages; index++)
+        {
+            const std::string payload = Payload(index);
+            mcap::Message message;
+            message.channelId = channel.id;
+            message.sequence = static_cast<uint32_t>(index);
+            message.logTime = index * 1000;
+            message.publishTime = message.logTime;
+            message.data = reinterpret_cast<const std::byte*>(payload.data());
+            message.dataSize = payload.size();
+            if (!Check(writer.Write(message).ok(), "could not write message " + std::to_string(index)))
+            {
+                return false;
+            }
+        }
+        writer.Close();
+    }
+
+    mcap::McapReader reader;
+    if (!Check(reader.open(path.string()).ok(), "could not read " + path.string()))
+    {
+        return false;
+    }
+    bool success = Check(reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan).ok(), path.string() + ": invalid summary");
+    success = Check(reader.chunkIndexes().size() > 1, path.string() + ": expected several chunks") && success;
+    for (const auto& [offset, chunk_index] : reader.chunkIndexes())
+    {
+        success = Check(chunk_index.uncompressedSize > 0, path.string() + ": chunk index without uncompressed size") && success;
+    }
+
+    size_t num_messages = 0;
+    const auto on_problem = [&success, &path](const mcap::Status& status) {
+        success = Check(false, path.string() + ": " + status.message);
+    };
+    for (const auto& view : reader.readMessages(on_problem))
+    {
+        const std::string payload(reinterpret_cast<const char*>(view.message.data), static_cast<size_t>(view.message.dataSize));
+        success = Check(payload == Payload(num_messages), path.string() + ": message " + std::to_string(num_messages) + " differs") && success;
+        num_messages++;
+    }
+    reader.close();
+    return Check(num_messages == kNumMessages, path.string() + ": read " + std::to_string(num_messages) + " messages") && success;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const std::filesystem::path folder = argc > 1 ? argv[1] : ".";
+    bool success = RoundTrip(folder / "parallel_zstd.mcap", mcap::Compression::Zstd);
+    success = RoundTrip(folder / "parallel_lz4.mcap", mcap::Compression::Lz4) && success;
+    success = RoundTrip(folder / "parallel_none.mcap", mcap::Compression::None) && success;
+    return success ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <lz4frame.h>
+#include <zstd.h>
+
+#include "FrameIndex.h"
+#include "RawBinaryTraceFileWriter.h"
+#include "RawMCAPTraceFileWriter.h"
+#include "RawTXTHTraceFileWriter.h"
+#include "TraceCheckpoint.h"
+#include "osi_groundtruth.pb.h"
+
+namespace
+{
+constexpr size_t kNumFrames = 40;
+/** frames written before the checkpoint, the remaining ones follow until the file is cut */
+constexpr size_t kCheckpointFrames = 25;
+/** bytes cut off the end of the complete file, which ends in the middle of the last frame then */
+constexpr uint64_t kCutSize = 7;
+
+std::filesystem::path recover_executable;
+
+bool Check(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << message << std::endl;
+    }
+    return condition;
+}
+
+/** Serialized GroundTruth with a timestamp and a payload of varying size */
+std::string Frame(size_t index)
+{
+    osi3::GroundTruth ground_truth;
+    ground_truth.mutable_version()->set_version_major(3);
+    ground_truth.mutable_timestamp()->set_seconds(static_cast<int64_t>(index));
+    ground_truth.mutable_timestamp()->set_nanos(500);
+    for (size_t object = 0; object < 1 + index % 5; object++)
+    {
+        ground_truth.add_moving_object()->mutable_id()->set_value(index * 10 + object);
+    }
+    return ground_truth.SerializeAsString();
+}
+
+/** Uncompressed frame stream of the first num_frames frames, as written to an .osi file */
+std::string FrameStream(size_t num_frames)
+{
+    std::string stream;
+    for (size_t index = 0; index < num_frames; index++)
+    {
+        const std::string frame = Frame(index);
+        const auto size = static_cast<uint32_t>(frame.size());
+        const char length_prefix[4] = {static_cast<char>(size & 0xFFU), static_cast<char>((size >> 8U) & 0xFFU),
+                                       static_cast<char>((size >> 16U) & 0xFFU), static_cast<char>((size >> 24U) & 0xFFU)};
+        stream.append(length_prefix, sizeof(length_prefix));
+        stream += frame;
+    }
+    return stream;
+}
+
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream input(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+}
+
+/** Decompress a complete zstd or lz4 frame, empty on error */
+std::string Decompress(const std::string& compressed, StreamCompression compression)
+{
+    std::string output;
+    std::vector<char> buffer(64 * 1024);
+    if (compression == StreamCompression::kZstd)
+    {
+        ZSTD_DCtx* context = ZSTD_createDCtx();
+        ZSTD_inBuffer input = {compressed.data(), compressed.size(), 0};
+        size_t result = 1;
+        while (result != 0 && input.pos < input.size)
+        {
+            ZSTD_outBuffer out = {buffer.data(), buffer.size(), 0};
+            result = ZSTD_decompressStream(context, &out, &input);
+            if (ZSTD_isError(result) != 0U)
+            {
+                output.clear();
+                break;
+            }
+            output.append(buffer.data(), out.pos);
+        }
+        ZSTD_freeDCtx(context);
+        return result == 0 ? output : std::string();
+    }
+
+    LZ4F_dctx* context = nullptr;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)) != 0U)
+    {
+        return output;
+    }
+    size_t position = 0;
+    size_t result = 1;
+    while (result != 0 && position < compressed.size())
+    {
+        size_t input_size = compressed.size() - position;
+        size_t output_size = buffer.size();
+        result = LZ4F_decompress(context, buffer.data(), &output_size, compressed.data() + position, &input_size, nullptr);
+        if (LZ4F_isError(result) != 0U)
+        {
+            break;
+        }
+        position += input_size;
+        output.append(buffer.data(), output_size);
+    }
+    LZ4F_freeDecompressionContext(context);
+    return result == 0 ? output : std::string();
+}
+
+/** Cut the end off the complete trace file and let trace_recover finalize it from its checkpoint */
+bool CutAndRecover(const std::filesystem::path& trace_path, const TraceCheckpoint& checkpoint)
+{
+    if (!Check(checkpoint.Write(TraceCheckpoint::Path(trace_path)), trace_path.string() + ": could not write the checkpoint"))
+    {
+        return false;
+    }
+    std::filesystem::resize_file(trace_path, std::filesystem::file_size(trace_path) - kCutSize);
+    const std::string command = "\"" + recover_executable.string() + "\" \"" + trace_path.string() + "\"";
+    return Check(std::system(command.c_str()) == 0, trace_path.string() + ": trace_recover failed") &&
+           Check(!std::filesystem::exists(trace_path) && !std::filesystem::exists(TraceCheckpoint::Path(trace_path)),
+                 trace_path.string() + ": temporary file or checkpoint left");
+}
+
+TraceCheckpoint NewCheckpoint(const std::string& name, const std::string& extension)
+{
+    TraceCheckpoint checkpoint;
+    checkpoint.final_name_prefix = name + "_";
+    checkpoint.final_name_suffix = "_recovered" + extension;
+    checkpoint.num_frames = kCheckpointFrames;
+    return checkpoint;
+}
+
+/** .osi, .osi.zst and .osi.lz4 with frame index */
+bool RecoverBinary(const std::filesystem::path& folder, const std::string& name, const std::string& extension, StreamCompression compression)
+{
+    const auto trace_path = folder / (name + extension);
+    TraceCheckpoint checkpoint = NewCheckpoint(name, extension);
+    checkpoint.has_index = true;
+    {
+        RawBinaryTraceFileWriter writer;
+        if (!Check(writer.Open(trace_path, compression) && writer.OpenIndex(FrameIndexPath(trace_path)), "could not open " + trace_path.string()))
+        {
+            return false;
+        }
+        for (size_t index = 0; index < kNumFrames; index++)
+        {
+            if (index == kCheckpointFrames)
+            {
+                Check(writer.Flush(), trace_path.string() + ": flush failed");
+                checkpoint.osi_data_end = writer.StreamOffset();
+                checkpoint.file_data_end = writer.FileOffset();
+            }
+            const std::string frame = Frame(index);
+            writer.WriteFrame(frame.data(), static_cast<int>(frame.size()));
+        }
+        writer.Close();
+    }
+    if (!CutAndRecover(trace_path, checkpoint))
+    {
+        return false;
+    }
+
+    // an uncompressed file keeps all complete frames, a compressed one the frames of the checkpoint
+    const size_t num_frames = compression == StreamCompression::kNone ? kNumFrames - 1 : kCheckpointFrames;
+    const auto final_path = folder / checkpoint.FinalFileName(num_frames);
+    std::string content = ReadFile(final_path);
+    if (compression != StreamCompression::kNone)
+    {
+        content = Decompress(content, compression);
+    }
+    bool success = Check(content == FrameStream(num_frames), final_path.string() + ": content differs from the first " + std::to_string(num_frames) + " frames");
+    success = Check(std::filesystem::exists(FrameIndexPath(final_path)) &&
+                        std::filesystem::file_size(FrameIndexPath(final_path)) == kFrameIndexMagicSize + kFrameIndexRecordSize * num_frames,
+                    final_path.string() + ": wrong frame index size") &&
+              success;
+    return success;
+}
+
+bool RecoverText(const std::filesystem::path& folder)
+{
+    const auto trace_path = folder / "txth.txth";
+    TraceCheckpoint checkpoint = NewCheckpoint("txth", ".txth");
+    std::string expected_text;
+    {
+        RawTXTHTraceFileWriter writer;
+        if (!Check(writer.Open(trace_path, 2), "could not open " + trace_path.string()))
+        {
+            return false;
+        }
+        for (size_t index = 0; index < kNumFrames; index++)
+        {
+            if (index == kCheckpointFrames)
+            {
+                Check(writer.Flush(), trace_path.string() + ": flush failed");
+                checkpoint.file_data_end = writer.FileOffset();
+            }
+            const std::string frame = Frame(index);
+            if (index < kCheckpointFrames)
+            {
+                std::string text;
+                FormatTextFrame<osi3::GroundTruth>(frame.data(), static_cast<int>(frame.size()), text);
+                expected_text += text;
+            }
+            writer.WriteFrame(frame.data(), static_cast<int>(frame.size()), &FormatTextFrame<osi3::GroundTruth>);
+        }
+        writer.Close();
+    }
+    if (!CutAndRecover(trace_path, checkpoint))
+    {
+        return false;
+    }
+    const auto final_path = folder / checkpoint.FinalFileName(kCheckpointFrames);
+    return Check(ReadFile(final_path) == expected_text, final_path.string() + ": text differs from the first " + std::to_string(kCheckpointFrames) + " frames");
+}
+
+bool RecoverMcap(const std::filesystem::path& folder)
+{
+    const auto trace_path = folder / "mcap.mcap";
+    TraceCheckpoint checkpoint = NewCheckpoint("mcap", ".mcap");
+    {
+        mcap::McapWriterOptions options("");
+        options.compression = mcap::Compression::Zstd;
+        options.chunkSize = 1024;
+        RawMCAPTraceFileWriter writer;
+        if (!Check(writer.Open(trace_path, options, 1), "could not open " + trace_path.string()))
+        {
+            return false;
+        }
+        const mcap::ChannelId channel = writer.AddChannel("gt", osi3::GroundTruth::descriptor(), {});
+        for (size_t index = 0; index < kNumFrames; index++)
+        {
+            if (index == kCheckpointFrames)
+            {
+                Check(writer.Checkpoint(checkpoint.mcap_summary, checkpoint.mcap_data_end), trace_path.string() + ": checkpoint failed");
+            }
+            const std::string frame = Frame(index);
+            writer.WriteFrame(channel, frame.data(), static_cast<int>(frame.size()), index * 1000000000, index * 1000000000);
+        }
+        writer.Close();
+    }
+    const std::string complete_file = ReadFile(trace_path);
+    if (!CutAndRecover(trace_path, checkpoint))
+    {
+        return false;
+    }
+    const auto final_path = folder / checkpoint.FinalFileName(kCheckpointFrames);
+    const std::string expected = complete_file.substr(0, checkpoint.mcap_data_end) + checkpoint.mcap_summary;
+    return Check(ReadFile(final_path) == expected, final_path.string() + ": not the data section of the checkpoint followed by its summary");
+}
+}  // namespace
+
+/**
+ * Writes a trace file of every format with a checkpoint in the middle, cuts the complete file in its last frame
+ * and checks the file finalized by trace_recover.
+ *
+ * Usage: trace_recovery_test <trace_recover executable> <folder>
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <trace_recover executable> <folder>" << std::endl;
+        return 2;
+    }
+    recover_executable = argv[1];
+    const std::filesystem::path folder = std::filesystem::path(argv[2]) / "trace_recovery";
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder);
+
+    bool success = RecoverBinary(folder, "osi", ".osi", StreamCompression::kNone);
+    success = RecoverBinary(folder, "zst", ".osi.zst", StreamCompression::kZstd) && success;
+    success = RecoverBinary(folder, "lz4", ".osi.lz4", StreamCompression::kLz4) && success;
+    success = RecoverText(folder) && success;
+    success = RecoverMcap(folder) && success;
+    return success ? 0 : 1;
+}
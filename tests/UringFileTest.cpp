@@ -0,0 +1,89 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "UringFile.h"
+
+namespace
+{
+/** Return code that marks the test as skipped, if the kernel does not provide io_uring */
+constexpr int kSkipped = 77;
+constexpr size_t kBufferSize = 64 * 1024;
+constexpr size_t kNumBuffers = 2;
+constexpr size_t kDataSize = 3 * 1024 * 1024 + 123;
+
+bool Check(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << message << std::endl;
+    }
+    return condition;
+}
+
+/**
+ * Writes from a single thread, like the writer thread of the trace file writer.
+ * The data is many times the buffers in flight, so Write() has to submit the queued writes, wait for and reap completions itself.
+ */
+bool WriteSynchronously(const std::filesystem::path& path, bool direct_io, const std::string& data)
+{
+    {
+        UringFile file;
+        if (!Check(file.Open(path, direct_io, kBufferSize, kNumBuffers), "could not open " + path.string()))
+        {
+            return false;
+        }
+        size_t position = 0;
+        for (size_t piece = 1; position < data.size(); piece = piece * 7 % 100003)
+        {
+            const size_t size = std::min(piece, data.size() - position);
+            if (!Check(file.Write(data.data() + position, size), path.string() + ": write failed at " + std::to_string(position)))
+            {
+                return false;
+            }
+            position += size;
+            if (position > data.size() / 2 && position - size <= data.size() / 2 && !Check(file.Flush(), path.string() + ": flush failed"))
+            {
+                return false;
+            }
+        }
+        if (!Check(file.Size() == data.size(), path.string() + ": wrong size " + std::to_string(file.Size())) ||
+            !Check(file.Close(), path.string() + ": close failed"))
+        {
+            return false;
+        }
+    }
+
+    std::ifstream input(path, std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    return Check(content == data, path.string() + ": content differs");
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const std::filesystem::path folder = argc > 1 ? argv[1] : ".";
+    if (!UringFile().Open(folder / "uring_probe.bin"))
+    {
+        std::cerr << "io_uring not available, skipped" << std::endl;
+        return kSkipped;
+    }
+
+    std::string data(kDataSize, '\0');
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = static_cast<char>(i * 31 + i / 4096);
+    }
+    bool success = WriteSynchronously(folder / "uring_buffered.bin", false, data);
+    success = WriteSynchronously(folder / "uring_direct.bin", true, data) && success;
+    return success ? 0 : 1;
+}
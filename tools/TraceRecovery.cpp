@@ -0,0 +1,408 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+/*
+ * Finalizes trace files of simulations that ended without fmi2Terminate, based on the checkpoints
+ * written with the checkpoint_interval parameter:
+ * - .osi: the frames are read once, the file is cut after the last complete frame and the frame index is rebuilt
+ * - .mcap: the file is cut at the data section of the last checkpoint and the summary section of the checkpoint is appended
+ * - .osi.zst, .osi.lz4: the file is cut at the compressed data flushed at the last checkpoint and the compressed frame is closed,
+ *   then it is decompressed once to count the frames and rebuild the frame index
+ * - .txth: the file is cut at the text written at the last checkpoint
+ * The file is then renamed like a regularly terminated trace file.
+ *
+ * Usage: trace_recover <trace folder | trace file | checkpoint file>...
+ */
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <lz4frame.h>
+#include <zstd.h>
+
+#include "FrameIndex.h"
+#include "OsiWireFormat.h"
+#include "StreamCompressor.h"
+#include "TraceCheckpoint.h"
+
+namespace
+{
+constexpr uint64_t kLengthPrefixSize = 4;
+
+bool EndsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * Read the frames of an uncompressed frame stream up to the last complete one, optionally writing their frame index records.
+ *
+ * \param stream frame stream
+ * \param stream_size size of the stream, a frame that would end behind it is cut off
+ * \param checkpoint_end end of the frames of the last checkpoint, empty frames behind it are only recovered if another frame follows them
+ * \param index_file rebuilt frame index, nullptr if the trace has no index
+ * \param num_frames number of recovered frames
+ * \return end of the recovered frames in the stream
+ */
+uint64_t ReadFrames(std::istream& stream, uint64_t stream_size, uint64_t checkpoint_end, std::ofstream* index_file, uint64_t& num_frames)
+{
+    std::vector<char> message;
+    uint64_t offset = 0;  // end of the recovered frames
+    uint64_t read_offset = 0;
+    uint64_t num_empty_frames = 0;  // empty frames after the checkpoint that are not recovered yet
+    num_frames = 0;
+    const auto recover_frame = [&](uint32_t size, uint64_t timestamp_ns) {
+        if (index_file != nullptr)
+        {
+            char record[kFrameIndexRecordSize];
+            EncodeFrameIndexRecord(record, static_cast<uint32_t>(num_frames), size, offset, timestamp_ns);
+            index_file->write(record, sizeof(record));
+        }
+        offset += kLengthPrefixSize + size;
+        num_frames++;
+    };
+
+    unsigned char length_prefix[kLengthPrefixSize];
+    while (stream.read(reinterpret_cast<char*>(length_prefix), sizeof(length_prefix)))
+    {
+        const uint32_t size = static_cast<uint32_t>(length_prefix[0]) | (static_cast<uint32_t>(length_prefix[1]) << 8U) |
+                              (static_cast<uint32_t>(length_prefix[2]) << 16U) | (static_cast<uint32_t>(length_prefix[3]) << 24U);
+        // a frame cut off by the crash ends the file
+        if (read_offset + sizeof(length_prefix) + size > stream_size)
+        {
+            break;
+        }
+        message.resize(size);
+        uint64_t timestamp_ns = 0;
+        if (!stream.read(message.data(), size) || !ReadTimestampNanoseconds(message.data(), static_cast<int>(size), timestamp_ns))
+        {
+            break;
+        }
+        read_offset += sizeof(length_prefix) + size;
+
+        // a memory mapped file is preallocated with zeros, which look like empty frames. Up to the checkpoint all frames are
+        // complete, after it empty frames are only recovered if another frame follows them
+        if (size == 0 && read_offset > checkpoint_end)
+        {
+            num_empty_frames++;
+            continue;
+        }
+        for (; num_empty_frames > 0; num_empty_frames--)
+        {
+            recover_frame(0, 0);
+        }
+        recover_frame(size, timestamp_ns);
+    }
+    return offset;
+}
+
+/** Cut the file after the last complete frame and count the frames, optionally rebuilding the frame index */
+bool RecoverOsi(const std::filesystem::path& trace_path, bool rebuild_index, uint64_t checkpoint_end, uint64_t& num_frames)
+{
+    std::ifstream trace_file(trace_path, std::ios::binary);
+    std::ofstream index_file;
+    if (rebuild_index)
+    {
+        index_file.open(FrameIndexPath(trace_path), std::ios::binary | std::ios::out | std::ios::trunc);
+        index_file.write(kFrameIndexMagic, kFrameIndexMagicSize);
+    }
+    const uint64_t end = ReadFrames(trace_file, std::filesystem::file_size(trace_path), checkpoint_end, rebuild_index ? &index_file : nullptr, num_frames);
+    trace_file.close();
+    std::filesystem::resize_file(trace_path, end);
+    index_file.close();
+    return !rebuild_index || index_file.good();
+}
+
+/** Input stream buffer that decompresses a single zstd or lz4 frame from a file */
+class DecompressingStreamBuffer final : public std::streambuf
+{
+  public:
+    DecompressingStreamBuffer(const std::filesystem::path& path, StreamCompression compression)
+        : file_(path, std::ios::binary), input_(kBufferSize), output_(kBufferSize)
+    {
+        if (compression == StreamCompression::kZstd)
+        {
+            zstd_context_ = ZSTD_createDCtx();
+        }
+        else if (LZ4F_isError(LZ4F_createDecompressionContext(&lz4_context_, LZ4F_VERSION)) != 0U)
+        {
+            lz4_context_ = nullptr;
+        }
+        failed_ = !file_.is_open() || (zstd_context_ == nullptr && lz4_context_ == nullptr);
+    }
+
+    ~DecompressingStreamBuffer() override
+    {
+        if (zstd_context_ != nullptr)
+        {
+            ZSTD_freeDCtx(zstd_context_);
+        }
+        if (lz4_context_ != nullptr)
+        {
+            LZ4F_freeDecompressionContext(lz4_context_);
+        }
+    }
+
+    DecompressingStreamBuffer(const DecompressingStreamBuffer&) = delete;
+    DecompressingStreamBuffer& operator=(const DecompressingStreamBuffer&) = delete;
+
+    /** True if the end of the compressed frame was decompressed without error */
+    bool Complete() const { return frame_end_ && !failed_; }
+
+    /** Bytes decompressed so far */
+    uint64_t DecompressedSize() const { return decompressed_size_; }
+
+  protected:
+    int_type underflow() override
+    {
+        while (!failed_ && !frame_end_)
+        {
+            if (input_position_ == input_size_)
+            {
+                file_.read(input_.data(), static_cast<std::streamsize>(input_.size()));
+                input_size_ = static_cast<size_t>(file_.gcount());
+                input_position_ = 0;
+                if (input_size_ == 0)
+                {
+                    // the file ends before the end of the frame
+                    failed_ = true;
+                    break;
+                }
+            }
+            size_t output_size = 0;
+            if (zstd_context_ != nullptr)
+            {
+                ZSTD_inBuffer input = {input_.data(), input_size_, input_position_};
+                ZSTD_outBuffer output = {output_.data(), output_.size(), 0};
+                const size_t result = ZSTD_decompressStream(zstd_context_, &output, &input);
+                failed_ = ZSTD_isError(result) != 0U;
+                frame_end_ = result == 0;
+                input_position_ = input.pos;
+                output_size = output.pos;
+            }
+            else
+            {
+                size_t input_size = input_size_ - input_position_;
+                output_size = output_.size();
+                const size_t result = LZ4F_decompress(lz4_context_, output_.data(), &output_size, input_.data() + input_position_, &input_size, nullptr);
+                failed_ = LZ4F_isError(result) != 0U;
+                frame_end_ = result == 0;
+                input_position_ += input_size;
+            }
+            if (output_size > 0 && !failed_)
+            {
+                decompressed_size_ += output_size;
+                setg(output_.data(), output_.data(), output_.data() + output_size);
+                return traits_type::to_int_type(output_[0]);
+            }
+        }
+        return traits_type::eof();
+    }
+
+  private:
+    static constexpr size_t kBufferSize = 256 * 1024;
+
+    std::ifstream file_;
+    std::vector<char> input_;
+    size_t input_position_ = 0;
+    size_t input_size_ = 0;
+    std::vector<char> output_;
+    ZSTD_DCtx* zstd_context_ = nullptr;
+    LZ4F_dctx* lz4_context_ = nullptr;
+    uint64_t decompressed_size_ = 0;
+    bool frame_end_ = false;
+    bool failed_ = false;
+};
+
+/**
+ * Cut the compressed file at the end of the output flushed at the checkpoint and close the compressed frame, then
+ * decompress it to count the frames and optionally rebuild the frame index
+ */
+bool RecoverCompressedOsi(const std::filesystem::path& trace_path, StreamCompression compression, const TraceCheckpoint& checkpoint, uint64_t& num_frames)
+{
+    if (checkpoint.file_data_end == 0 || std::filesystem::file_size(trace_path) < checkpoint.file_data_end)
+    {
+        std::cerr << trace_path.string() << ": the checkpoint does not match the compressed file" << std::endl;
+        return false;
+    }
+    std::filesystem::resize_file(trace_path, checkpoint.file_data_end);
+    {
+        // zstd: last block of the frame, empty and uncompressed. lz4: end mark, there is no content checksum
+        const char zstd_frame_end[] = {1, 0, 0};
+        const char lz4_frame_end[] = {0, 0, 0, 0};
+        std::ofstream trace_file(trace_path, std::ios::binary | std::ios::out | std::ios::app);
+        if (compression == StreamCompression::kZstd)
+        {
+            trace_file.write(zstd_frame_end, sizeof(zstd_frame_end));
+        }
+        else
+        {
+            trace_file.write(lz4_frame_end, sizeof(lz4_frame_end));
+        }
+        trace_file.close();
+        if (!trace_file)
+        {
+            std::cerr << trace_path.string() << ": could not complete the compressed frame" << std::endl;
+            return false;
+        }
+    }
+
+    DecompressingStreamBuffer buffer(trace_path, compression);
+    std::istream stream(&buffer);
+    std::ofstream index_file;
+    if (checkpoint.has_index)
+    {
+        index_file.open(FrameIndexPath(trace_path), std::ios::binary | std::ios::out | std::ios::trunc);
+        index_file.write(kFrameIndexMagic, kFrameIndexMagicSize);
+    }
+    // all frames up to the checkpoint are complete, so there is no end of the stream to guess
+    const uint64_t end = ReadFrames(stream, std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max(),
+                                    checkpoint.has_index ? &index_file : nullptr, num_frames);
+    index_file.close();
+    if (!buffer.Complete() || end != buffer.DecompressedSize())
+    {
+        std::cerr << trace_path.string() << ": the data up to the checkpoint could not be decompressed into complete frames" << std::endl;
+        return false;
+    }
+    return !checkpoint.has_index || index_file.good();
+}
+
+/** Cut the file at the end of the text written at the checkpoint */
+bool RecoverText(const std::filesystem::path& trace_path, const TraceCheckpoint& checkpoint)
+{
+    if (checkpoint.file_data_end == 0 || std::filesystem::file_size(trace_path) < checkpoint.file_data_end)
+    {
+        std::cerr << trace_path.string() << ": the checkpoint does not match the txth file" << std::endl;
+        return false;
+    }
+    std::filesystem::resize_file(trace_path, checkpoint.file_data_end);
+    return true;
+}
+
+/** Complete the data section up to the checkpoint with the summary section built at the checkpoint */
+bool RecoverMcap(const std::filesystem::path& trace_path, const TraceCheckpoint& checkpoint)
+{
+    if (checkpoint.mcap_summary.empty() || std::filesystem::file_size(trace_path) < checkpoint.mcap_data_end)
+    {
+        std::cerr << trace_path.string() << ": the checkpoint does not match the mcap file" << std::endl;
+        return false;
+    }
+    std::filesystem::resize_file(trace_path, checkpoint.mcap_data_end);
+    std::ofstream trace_file(trace_path, std::ios::binary | std::ios::out | std::ios::app);
+    trace_file.write(checkpoint.mcap_summary.data(), static_cast<std::streamsize>(checkpoint.mcap_summary.size()));
+    trace_file.close();
+    return trace_file.good();
+}
+
+bool RecoverTrace(const std::filesystem::path& checkpoint_path)
+{
+    TraceCheckpoint checkpoint;
+    if (!checkpoint.Read(checkpoint_path))
+    {
+        std::cerr << checkpoint_path.string() << ": could not read checkpoint" << std::endl;
+        return false;
+    }
+    auto trace_path = checkpoint_path;
+    trace_path.replace_extension();
+    if (!std::filesystem::exists(trace_path))
+    {
+        // the trace file was finalized, but the process ended before the checkpoint was removed
+        std::filesystem::remove(checkpoint_path);
+        return true;
+    }
+
+    uint64_t num_frames = checkpoint.num_frames;
+    const std::string file_name = trace_path.filename().string();
+    bool recovered = true;
+    if (EndsWith(file_name, ".mcap"))
+    {
+        recovered = RecoverMcap(trace_path, checkpoint);
+    }
+    else if (EndsWith(file_name, ".osi"))
+    {
+        recovered = RecoverOsi(trace_path, checkpoint.has_index, checkpoint.osi_data_end, num_frames);
+    }
+    else if (EndsWith(file_name, ".osi.zst") || EndsWith(file_name, ".osi.lz4"))
+    {
+        const auto compression = EndsWith(file_name, ".zst") ? StreamCompression::kZstd : StreamCompression::kLz4;
+        recovered = RecoverCompressedOsi(trace_path, compression, checkpoint, num_frames);
+    }
+    else if (EndsWith(file_name, ".txth"))
+    {
+        recovered = RecoverText(trace_path, checkpoint);
+    }
+    else
+    {
+        std::cerr << trace_path.string() << ": unknown trace file format" << std::endl;
+        recovered = false;
+    }
+    if (!recovered)
+    {
+        return false;
+    }
+
+    const auto final_path = trace_path.parent_path() / checkpoint.FinalFileName(num_frames);
+    std::filesystem::rename(trace_path, final_path);
+    if (checkpoint.has_index && std::filesystem::exists(FrameIndexPath(trace_path)))
+    {
+        std::filesystem::rename(FrameIndexPath(trace_path), FrameIndexPath(final_path));
+    }
+    std::filesystem::remove(checkpoint_path);
+    std::cout << trace_path.string() << " -> " << final_path.filename().string() << " (" << num_frames << " frames)" << std::endl;
+    return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <trace folder | trace file | checkpoint file>..." << std::endl;
+        return 2;
+    }
+
+    std::vector<std::filesystem::path> checkpoints;
+    for (int arg = 1; arg < argc; arg++)
+    {
+        const std::filesystem::path path(argv[arg]);
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error))
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(path, error))
+            {
+                if (entry.path().extension() == ".checkpoint")
+                {
+                    checkpoints.push_back(entry.path());
+                }
+            }
+        }
+        else
+        {
+            checkpoints.push_back(path.extension() == ".checkpoint" ? path : TraceCheckpoint::Path(path));
+        }
+    }
+
+    bool success = true;
+    for (const auto& checkpoint : checkpoints)
+    {
+        try
+        {
+            success = RecoverTrace(checkpoint) && success;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << checkpoint.string() << ": " << e.what() << std::endl;
+            success = false;
+        }
+    }
+    return success ? 0 : 1;
+}
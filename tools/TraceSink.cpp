@@ -0,0 +1,458 @@
+//
+// Copyright 2023 BMW AG
+// SPDX-License-Identifier: MPL-2.0
+//
+
+/*
+ * Local sink process for many FMU instances on one host, see the trace_sink parameter of the FMU.
+ * The instances hand their frames over shared memory rings, this process writes them with one thread:
+ * - default: one trace file per instance in its trace path, named and written as the instance would have done it
+ * - --merge: one mcap file in the trace folder with a channel per instance and input, topic <custom name or instance slot>/<topic>.
+ *   It is named like a trace file with the sink name as custom name, message type and versions are those of the first frame
+ * Frames are taken from each ring in batches, so every file is written in long sequential runs.
+ * SIGINT or SIGTERM finalize all open trace files and stop the sink.
+ *
+ * Usage: trace_sink [--merge] [--mcap-compression zstd|lz4|none] [--mcap-compression-level N] [--mcap-chunk-size N] [--mcap-compression-threads N]
+ *                   [--txth-format-threads N] [--io-uring] [--osi-index] <sink name> <trace folder>
+ */
+
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrameWriter.h"
+#include "ShmFrameRing.h"
+#include "TraceFileWriter.h"
+#include "TraceSinkClient.h"
+#include "osi-utilities/tracefile/writer/MCAPTraceFileWriter.h"
+#include "osi_sensordata.pb.h"
+#include "osi_sensorview.pb.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr size_t kBatchFrames = 64;
+constexpr std::chrono::milliseconds kIdleTimeout{100};
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void RequestStop(int /*signal*/)
+{
+    stop_requested = 1;
+}
+
+struct SinkOptions
+{
+    bool merge = false;
+    TraceFileWriterOptions writer_options;
+    std::string sink_name;
+    std::filesystem::path trace_folder;
+};
+
+/** Frames of one registered FMU instance */
+struct Instance
+{
+    ShmFrameRing ring;
+    int32_t pid = 0;
+    std::string protobuf_version;
+    std::vector<std::string> message_types;                      // by channel
+    std::unique_ptr<TraceFileWriter> writer;                     // one trace file per instance
+    std::vector<std::string> osi_versions;                       // merged file: set by the channel writers on their first frame
+    std::vector<std::unique_ptr<IFrameWriter>> channel_writers;  // merged file: one per input of the instance
+    bool write_failed = false;
+};
+
+/** Single mcap file all instances are written to with --merge */
+struct MergedTrace
+{
+    RawMCAPTraceFileWriter writer;
+    std::string start_time;
+    std::filesystem::path temp_path;
+    // of the first frame, for the final file name
+    std::string message_type;
+    std::string osi_version;
+    std::string protobuf_version;
+    uint64_t num_frames = 0;
+};
+
+std::string StartTime()
+{
+    time_t current_time{};
+    time(&current_time);
+    char buffer[20];
+    strftime(buffer, sizeof(buffer), "%Y%m%dT%H%M%SZ", localtime(&current_time));
+    return buffer;
+}
+
+std::unique_ptr<IFrameWriter> CreateMergedChannelWriter(const std::string& message_type, RawMCAPTraceFileWriter& writer, std::string* osi_version, const std::string& topic)
+{
+    if (message_type == "sv")
+    {
+        return std::make_unique<FrameWriter<osi3::SensorView, FileFormat::MCAP>>(writer, osi_version, topic);
+    }
+    if (message_type == "sd")
+    {
+        return std::make_unique<FrameWriter<osi3::SensorData, FileFormat::MCAP>>(writer, osi_version, topic);
+    }
+    if (message_type == "gt")
+    {
+        return std::make_unique<FrameWriter<osi3::GroundTruth, FileFormat::MCAP>>(writer, osi_version, topic);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Instance> Attach(const TraceSinkSlot& slot, size_t slot_index, const SinkOptions& options, MergedTrace* merged)
+{
+    auto instance = std::make_unique<Instance>();
+    if (!instance->ring.Open(slot.ring_name))
+    {
+        return nullptr;
+    }
+    if (slot.num_channels == 0 || slot.num_channels > kTraceSinkMaxChannels)
+    {
+        instance->ring.CloseConsumer();
+        return nullptr;
+    }
+    instance->pid = slot.pid;
+    instance->protobuf_version = slot.protobuf_version;
+    std::vector<TraceChannel> channels;
+    for (uint32_t channel = 0; channel < slot.num_channels; channel++)
+    {
+        channels.push_back({slot.channels[channel].message_type, slot.channels[channel].topic});
+        instance->message_types.push_back(channels.back().message_type);
+    }
+    const std::string custom_name = slot.custom_name;
+
+    if (merged != nullptr)
+    {
+        const std::string instance_name = custom_name.empty() ? "instance" + std::to_string(slot_index) : custom_name;
+        instance->osi_versions.resize(channels.size());
+        for (size_t channel = 0; channel < channels.size(); channel++)
+        {
+            auto channel_writer = CreateMergedChannelWriter(channels[channel].message_type, merged->writer, &instance->osi_versions[channel], instance_name + "/" + channels[channel].topic);
+            if (!channel_writer)
+            {
+                std::cerr << "Unknown message type: " << channels[channel].message_type << std::endl;
+                instance->ring.CloseConsumer();
+                return nullptr;
+            }
+            instance->channel_writers.push_back(std::move(channel_writer));
+        }
+        return instance;
+    }
+
+    auto writer_options = options.writer_options;
+    writer_options.topic = channels.front().topic;
+    writer_options.additional_channels.assign(channels.begin() + 1, channels.end());
+    instance->writer = std::make_unique<TraceFileWriter>();
+    try
+    {
+        instance->writer->Init(slot.trace_path[0] != '\0' ? std::string(slot.trace_path) : options.trace_folder.string(),
+                               slot.protobuf_version,
+                               custom_name,
+                               channels.front().message_type,
+                               static_cast<FileFormat>(slot.file_format),
+                               slot.omit_timestamp != 0,
+                               writer_options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Could not open the trace file of " << slot.ring_name << ": " << e.what() << std::endl;
+        instance->ring.CloseConsumer();
+        return nullptr;
+    }
+    return instance;
+}
+
+/** Write up to max_frames frames of the instance, returns the number of frames taken from its ring */
+size_t Drain(Instance& instance, size_t max_frames, MergedTrace* merged)
+{
+    size_t num_frames = 0;
+    ShmFrameRing::Frame frame;
+    while (num_frames < max_frames && instance.ring.Front(frame))
+    {
+        bool written = false;
+        if (merged != nullptr)
+        {
+            written = frame.channel < instance.channel_writers.size() &&
+                      instance.channel_writers[frame.channel]->Write(frame.data, static_cast<int>(frame.size), frame.sim_time);
+            if (written && merged->num_frames++ == 0)
+            {
+                merged->message_type = instance.message_types[frame.channel];
+                merged->osi_version = instance.osi_versions[frame.channel];
+                merged->protobuf_version = instance.protobuf_version;
+            }
+        }
+        else
+        {
+            written = instance.writer->Step(frame.data, static_cast<int>(frame.size), frame.sim_time, frame.channel);
+        }
+        if (!written && !instance.write_failed)
+        {
+            std::cerr << "Could not write a frame of process " << instance.pid << std::endl;
+            instance.write_failed = true;
+        }
+        instance.ring.PopFront();
+        num_frames++;
+    }
+    return num_frames;
+}
+
+void Finish(Instance& instance)
+{
+    if (instance.writer)
+    {
+        instance.writer->Term();
+    }
+    instance.ring.CloseConsumer();
+    instance.ring.Unlink();
+}
+
+bool ParseArguments(int argc, char* argv[], SinkOptions& options)
+{
+    std::vector<std::string> positional;
+    for (int arg = 1; arg < argc; arg++)
+    {
+        const std::string argument = argv[arg];
+        const bool has_value = arg + 1 < argc;
+        if (argument == "--merge")
+        {
+            options.merge = true;
+        }
+        else if (argument == "--mcap-compression" && has_value)
+        {
+            const std::string compression = argv[++arg];
+            if (compression == "zstd")
+            {
+                options.writer_options.mcap_compression = McapCompression::kZstd;
+            }
+            else if (compression == "lz4")
+            {
+                options.writer_options.mcap_compression = McapCompression::kLz4;
+            }
+            else if (compression == "none")
+            {
+                options.writer_options.mcap_compression = McapCompression::kNone;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (argument == "--mcap-compression-level" && has_value)
+        {
+            options.writer_options.mcap_compression_level = std::stoi(argv[++arg]);
+        }
+        else if (argument == "--mcap-chunk-size" && has_value)
+        {
+            options.writer_options.mcap_chunk_size = std::stoull(argv[++arg]);
+        }
+        else if (argument == "--mcap-compression-threads" && has_value)
+        {
+            options.writer_options.mcap_compression_threads = std::stoul(argv[++arg]);
+        }
+        else if (argument == "--txth-format-threads" && has_value)
+        {
+            options.writer_options.txth_format_threads = std::stoul(argv[++arg]);
+        }
+        else if (argument == "--io-uring")
+        {
+            options.writer_options.io_uring_output = true;
+        }
+        else if (argument == "--osi-index")
+        {
+            options.writer_options.osi_index = true;
+        }
+        else if (argument.rfind("--", 0) == 0)
+        {
+            return false;
+        }
+        else
+        {
+            positional.push_back(argument);
+        }
+    }
+    if (positional.size() != 2 || !TraceSinkControl::ValidSinkName(positional[0]))
+    {
+        return false;
+    }
+    options.sink_name = positional[0];
+    options.trace_folder = positional[1];
+    return true;
+}
+
+/** Remove the rings of a killed sink, their instances cannot reach the new sink anyway */
+void RemoveStaleRings(const std::string& sink_name)
+{
+    // POSIX shared memory objects are files in /dev/shm on Linux
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/dev/shm", error))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(sink_name + ".", 0) == 0)
+        {
+            ShmSegment::Unlink("/" + name);
+        }
+    }
+}
+
+bool CreateControl(const std::string& sink_name, ShmSegment& control_segment)
+{
+    const std::string segment_name = TraceSinkControl::SegmentName(sink_name);
+    if (!control_segment.Create(segment_name, sizeof(TraceSinkControl)))
+    {
+        // left over by a sink that was killed
+        ShmSegment previous;
+        if (previous.Open(segment_name) && previous.Size() >= sizeof(TraceSinkControl) &&
+            ProcessAlive(static_cast<TraceSinkControl*>(previous.Data())->sink_pid.load(std::memory_order_acquire)))
+        {
+            std::cerr << "A trace sink " << sink_name << " is already running" << std::endl;
+            return false;
+        }
+        ShmSegment::Unlink(segment_name);
+        RemoveStaleRings(sink_name);
+        if (!control_segment.Create(segment_name, sizeof(TraceSinkControl)))
+        {
+            std::cerr << "Could not create the shared memory segment " << segment_name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    SinkOptions options;
+    try
+    {
+        if (!ParseArguments(argc, argv, options))
+        {
+            throw std::invalid_argument("invalid arguments");
+        }
+    }
+    catch (const std::exception&)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--merge] [--mcap-compression zstd|lz4|none] [--mcap-compression-level N] [--mcap-chunk-size N] [--mcap-compression-threads N]"
+                  << " [--txth-format-threads N] [--io-uring] [--osi-index] <sink name> <trace folder>" << std::endl;
+        return 2;
+    }
+    std::filesystem::create_directories(options.trace_folder);
+
+    ShmSegment control_segment;
+    if (!CreateControl(options.sink_name, control_segment))
+    {
+        return 1;
+    }
+    auto* control = new (control_segment.Data()) TraceSinkControl();
+    std::memcpy(control->magic, TraceSinkControl::kMagic, sizeof(TraceSinkControl::kMagic));
+
+    std::unique_ptr<MergedTrace> merged;
+    if (options.merge)
+    {
+        merged = std::make_unique<MergedTrace>();
+        merged->start_time = StartTime();
+        merged->temp_path = options.trace_folder / (merged->start_time + "_" + options.sink_name + ".mcap");
+        const auto mcap_options = RawMCAPTraceFileWriter::WriterOptions(options.writer_options);
+        const bool opened = options.writer_options.io_uring_output &&
+                            merged->writer.OpenUring(merged->temp_path, mcap_options, options.writer_options.mcap_compression_threads, false);
+        if (!opened && !merged->writer.Open(merged->temp_path, mcap_options, options.writer_options.mcap_compression_threads))
+        {
+            std::cerr << "Could not open " << merged->temp_path.string() << std::endl;
+            return 1;
+        }
+        merged->writer.AddFileMetadata(osi3::MCAPTraceFileWriter::PrepareRequiredFileMetadata());
+    }
+
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+#ifdef __linux__
+    control->sink_pid.store(static_cast<int32_t>(getpid()), std::memory_order_release);
+#endif
+    std::cout << "Trace sink " << options.sink_name << " writing to " << options.trace_folder.string() << std::endl;
+
+    std::vector<std::unique_ptr<Instance>> instances(kTraceSinkMaxInstances);
+    while (true)
+    {
+        const bool stopping = stop_requested != 0;
+        if (stopping)
+        {
+            // new instances write their own trace files from now on
+            control->sink_pid.store(0, std::memory_order_seq_cst);
+        }
+        size_t num_frames = 0;
+        for (size_t slot_index = 0; slot_index < kTraceSinkMaxInstances; slot_index++)
+        {
+            auto& slot = control->slots[slot_index];
+            auto& instance = instances[slot_index];
+            if (!instance)
+            {
+                if (slot.state.load(std::memory_order_acquire) != static_cast<uint32_t>(TraceSinkSlotState::kActive))
+                {
+                    continue;
+                }
+                instance = Attach(slot, slot_index, options, merged.get());
+                if (!instance)
+                {
+                    ShmSegment::Unlink(slot.ring_name);
+                    slot.state.store(static_cast<uint32_t>(TraceSinkSlotState::kFree), std::memory_order_release);
+                    continue;
+                }
+            }
+
+            // the closed flag is read before the ring is found empty, so no frame pushed before closing is lost.
+            // A crashed instance cannot push anymore, its ring only has to be empty once
+            const bool closed = instance->ring.ProducerClosed();
+            const bool crashed = !closed && instance->ring.Empty() && !ProcessAlive(instance->pid);
+            num_frames += Drain(*instance, stopping ? SIZE_MAX : kBatchFrames, merged.get());
+            if ((closed || crashed || stopping) && instance->ring.Empty())
+            {
+                Finish(*instance);
+                instance.reset();
+                slot.state.store(static_cast<uint32_t>(TraceSinkSlotState::kFree), std::memory_order_release);
+            }
+        }
+        if (stopping)
+        {
+            break;
+        }
+        if (num_frames == 0)
+        {
+            // sleep until an instance pushes frames, registers or closes, the timeout covers crashed instances
+            control->sink_sleeping.store(1, std::memory_order_seq_cst);
+            const uint32_t doorbell = control->doorbell.load(std::memory_order_seq_cst);
+            bool idle = true;
+            for (size_t slot_index = 0; slot_index < kTraceSinkMaxInstances && idle; slot_index++)
+            {
+                const auto& instance = instances[slot_index];
+                idle = instance ? instance->ring.Empty() && !instance->ring.ProducerClosed()
+                                : control->slots[slot_index].state.load(std::memory_order_seq_cst) != static_cast<uint32_t>(TraceSinkSlotState::kActive);
+            }
+            if (idle)
+            {
+                ShmFutexWait(control->doorbell, doorbell, kIdleTimeout);
+            }
+            control->sink_sleeping.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    if (merged)
+    {
+        merged->writer.Close();
+        // <start time>_<type>_<osi version>_<protobuf version>_<frames>_<sink name>.mcap, like the trace files of the instances
+        const auto final_path = options.trace_folder / (merged->start_time + "_" + merged->message_type + "_" + merged->osi_version + "_" + merged->protobuf_version + "_" +
+                                                        std::to_string(merged->num_frames) + "_" + options.sink_name + ".mcap");
+        std::filesystem::rename(merged->temp_path, final_path);
+        std::cout << "Wrote " << final_path.string() << std::endl;
+    }
+    return 0;
+}